@@ -41,16 +41,6 @@ std::vector<unsigned char> FindZeros(const GF& gf,
   return zeros;
 }
 
-// Evaluate the dot product of two vectors using GF arithmetic.
-unsigned char DotProduct(const GF& gf, const std::vector<unsigned char>& a,
-                         const std::vector<unsigned char>& b) {
-  unsigned char res = 0;
-  for (int i = 0; i < a.size(); ++i) {
-    res = gf.Add({res, gf.Mult(a[i], b[i])});
-  }
-  return res;
-}
-
 // Implements the Peterson-Gorenstein-Zeirler algorithm to calculate the error
 // locator polynomial that corresponds to a passed-in set of syndromes. See
 // https://en.m.wikipedia.org/wiki/BCH_code#Peterson-Gorenstein-Zierler_algorithm
@@ -72,14 +62,15 @@ std::vector<unsigned char> PGZ(const GF& gf, int c, int t,
   int v = t;
 
   for (; v > 0;) {
-    // Steps 1 and 2: Make matrices S_{v,v} and C_{v,1}
+    // Steps 1 and 2: Make matrices S_{v,v} and C_{v,1}. For v <= 16 the
+    // matrices are stored inline, so this doesn't allocate.
     GFSqMat a(gf, v);
-    std::vector<unsigned char> cvec(v);
+    GFMat cvec(gf, v, 1);
     for (int y = 0; y < v; ++y) {
       for (int x = 0; x < v; ++x) {
         a.Set(x, y, syndromes[c + x + y]);
       }
-      cvec[y] = syndromes[c + v + y];
+      cvec.Set(y, 0, syndromes[c + v + y]);
     }
 
     // There's no code for steps 3 or 4 since they're just defining terms we'll
@@ -103,8 +94,8 @@ std::vector<unsigned char> PGZ(const GF& gf, int c, int t,
     // Step 5: The determinant is non-zero, which means we can invert S_{v,v}
     // which in turn means we can solve the above equation for
     // lambda_{v,1}.
-    std::unique_ptr<GFSqMat> inv_a = a.Inverse();
-    if (inv_a == nullptr) {
+    GFSqMat inv_a(gf, v);
+    if (!a.Inverse(&inv_a)) {
       std::cerr << "failed to invert\n";  // this shouldn't happen
       return {};
     }
@@ -117,9 +108,13 @@ std::vector<unsigned char> PGZ(const GF& gf, int c, int t,
     //
     // The vector `lambda` contains these coefficients in order, starting with a
     // lambda_0=1.
-    std::vector<unsigned char> lambda(inv_a->h());
-    for (int i = 0; i < inv_a->h(); ++i) {
-      lambda[v - i - 1] = DotProduct(gf, inv_a->Row(i), cvec);
+    std::vector<unsigned char> lambda(v);
+    for (int i = 0; i < v; ++i) {
+      unsigned char res = 0;
+      for (int j = 0; j < v; ++j) {
+        res = gf.Add({res, gf.Mult(inv_a.Get(i, j), cvec.Get(j, 0))});
+      }
+      lambda[v - i - 1] = res;
     }
 
     // Step 7: We're done.
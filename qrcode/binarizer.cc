@@ -0,0 +1,134 @@
+#include "qrcode/binarizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+
+void GlobalBinarizer::Binarize(const cv::Mat& in, cv::OutputArray out) const {
+  cv::threshold(in, out, threshold_, 255, cv::THRESH_BINARY);
+}
+
+LocalMeanBinarizer::LocalMeanBinarizer(int window_size, int percent,
+                                       int num_threads)
+    : window_size_(window_size),
+      percent_(percent),
+      num_threads_(num_threads) {}
+
+namespace {
+
+// An integral image: entry {x, y} holds the sum of the pixels above and to the
+// left of {x, y}. It has one more row and column than the source image.
+//
+// Sums are 32 bits and wrap on very large images, but that's harmless: the sum
+// of any block small enough to fit in 32 bits still comes out right, because
+// the wraparound cancels in the subtraction.
+class IntegralImage {
+ public:
+  explicit IntegralImage(const cv::Mat& image)
+      : stride_(image.cols + 1), sums_(stride_ * (image.rows + 1), 0) {
+    for (int y = 0; y < image.rows; ++y) {
+      const unsigned char* in = image.ptr<unsigned char>(y);
+      const uint32_t* prev = Row(y);
+      uint32_t* cur = &sums_[(y + 1) * stride_];
+
+      uint32_t row_sum = 0;
+      for (int x = 0; x < image.cols; ++x) {
+        row_sum += in[x];
+        cur[x + 1] = prev[x + 1] + row_sum;
+      }
+    }
+  }
+
+  const uint32_t* Row(int y) const { return &sums_[y * stride_]; }
+
+ private:
+  const int stride_;
+  std::vector<uint32_t> sums_;
+};
+
+// Thresholds row y of in into out, given the integral image rows that bound
+// the window vertically, and the number of rows between them.
+void ThresholdRow(const unsigned char* in, unsigned char* out, int width,
+                  const uint32_t* top, const uint32_t* bottom, int rows,
+                  int radius, int percent) {
+  // A pixel is black if pixel <= mean * (100 - percent) / 100. Multiplying
+  // through by the window area and 100 keeps everything in integers.
+  const int keep = 100 - percent;
+  auto threshold = [&](int x, int x0, int x1) {
+    const uint32_t sum = bottom[x1] - bottom[x0] - top[x1] + top[x0];
+    const uint64_t area = static_cast<uint64_t>(x1 - x0) * rows * 100;
+    out[x] = in[x] * area > uint64_t{sum} * keep ? 255 : 0;
+  };
+
+  // The window is only clipped near the left and right edges. The loop over
+  // the middle has no clamping, and a constant area, so it vectorizes.
+  const int mid_start = std::min(radius, width);
+  const int mid_end = std::max(mid_start, width - radius);
+
+  for (int x = 0; x < mid_start; ++x) {
+    threshold(x, 0, std::min(width, x + radius + 1));
+  }
+
+  const uint64_t area = static_cast<uint64_t>(2 * radius + 1) * rows * 100;
+  for (int x = mid_start; x < mid_end; ++x) {
+    const uint32_t sum = bottom[x + radius + 1] - bottom[x - radius] -
+                         top[x + radius + 1] + top[x - radius];
+    out[x] = in[x] * area > uint64_t{sum} * keep ? 255 : 0;
+  }
+
+  for (int x = mid_end; x < width; ++x) {
+    threshold(x, std::max(0, x - radius), std::min(width, x + radius + 1));
+  }
+}
+
+}  // namespace
+
+void LocalMeanBinarizer::Binarize(const cv::Mat& in,
+                                  cv::OutputArray out) const {
+  const int radius = (window_size_ > 0 ? window_size_ : in.cols / 8) / 2;
+
+  // Build the integral image first, so that out may alias in: once the sums
+  // exist, each row of in is only read while writing the same row of out.
+  const IntegralImage integral(in);
+  out.create(in.rows, in.cols, CV_8UC1);
+  cv::Mat dst = out.getMat();
+
+  auto threshold_rows = [&](int start_row, int end_row) {
+    for (int y = start_row; y < end_row; ++y) {
+      const int y0 = std::max(0, y - radius);
+      const int y1 = std::min(in.rows, y + radius + 1);
+      ThresholdRow(in.ptr<unsigned char>(y), dst.ptr<unsigned char>(y),
+                   in.cols, integral.Row(y0), integral.Row(y1), y1 - y0,
+                   radius, percent_);
+    }
+  };
+
+  const int num_bands = std::max(1, std::min(num_threads_, in.rows));
+  auto band_start = [&](int band) {
+    return static_cast<long>(in.rows) * band / num_bands;
+  };
+
+  // The calling thread takes the first band.
+  std::vector<std::thread> threads;
+  for (int band = 1; band < num_bands; ++band) {
+    threads.emplace_back(threshold_rows, band_start(band),
+                         band_start(band + 1));
+  }
+  threshold_rows(0, band_start(1));
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+std::unique_ptr<Binarizer> MakeBinarizer(const std::string& name,
+                                         int num_threads) {
+  if (name == "global") {
+    return absl::make_unique<GlobalBinarizer>();
+  } else if (name == "local") {
+    return absl::make_unique<LocalMeanBinarizer>(0, 15, num_threads);
+  }
+  return nullptr;
+}
@@ -0,0 +1,67 @@
+#ifndef _QRCODE_BINARIZER_H_
+#define _QRCODE_BINARIZER_H_ 1
+
+#include <memory>
+#include <string>
+
+#include "opencv2/opencv.hpp"
+
+// Converts single-channel 8-bit grayscale images to black (0) and white (255).
+class Binarizer {
+ public:
+  virtual ~Binarizer() = default;
+
+  // Binarizes in into out, which may be the same Mat as in. out is
+  // (re)allocated if it isn't already the same size as in.
+  virtual void Binarize(const cv::Mat& in, cv::OutputArray out) const = 0;
+};
+
+// Compares every pixel against the same threshold. Pixels greater than the
+// threshold become white.
+class GlobalBinarizer : public Binarizer {
+ public:
+  explicit GlobalBinarizer(int threshold = 127) : threshold_(threshold) {}
+  ~GlobalBinarizer() override = default;
+
+  void Binarize(const cv::Mat& in, cv::OutputArray out) const override;
+
+ private:
+  const int threshold_;
+};
+
+// Compares each pixel against the mean of the window_size x window_size block
+// centered on it (clipped to the image), in the style of Bradley and Roth's
+// adaptive thresholding. A pixel becomes black if it's at least percent percent
+// darker than that mean. This copes with uneven lighting, which a single
+// global threshold doesn't, as long as the window is large compared to the
+// features being thresholded -- a dark region that fills the window is
+// indistinguishable from a dimly lit light one.
+//
+// If window_size is 0, the window is an eighth of the image width, as Bradley
+// and Roth suggest.
+//
+// The block means come from an integral image, so the cost per pixel doesn't
+// depend on window_size. The integral image is built in one pass, after which
+// bands of rows are thresholded on num_threads threads.
+class LocalMeanBinarizer : public Binarizer {
+ public:
+  LocalMeanBinarizer(int window_size, int percent, int num_threads);
+  ~LocalMeanBinarizer() override = default;
+
+  void Binarize(const cv::Mat& in, cv::OutputArray out) const override;
+
+ private:
+  const int window_size_;
+  const int percent_;
+  const int num_threads_;
+};
+
+// Returns the binarizer with the given name, or nullptr if there isn't one.
+// The names are "global", for a GlobalBinarizer with the default threshold,
+// and "local", for a LocalMeanBinarizer with the window size and percentage
+// suggested by Bradley and Roth. num_threads is used by binarizers that
+// support it.
+std::unique_ptr<Binarizer> MakeBinarizer(const std::string& name,
+                                         int num_threads);
+
+#endif  // _QRCODE_BINARIZER_H_
@@ -0,0 +1,84 @@
+#include "qrcode/binarizer.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Returns true if a and b have the same size and pixels.
+bool SameImage(const cv::Mat& a, const cv::Mat& b) {
+  if (a.rows != b.rows || a.cols != b.cols) {
+    return false;
+  }
+  for (int y = 0; y < a.rows; ++y) {
+    for (int x = 0; x < a.cols; ++x) {
+      if (a.at<unsigned char>(y, x) != b.at<unsigned char>(y, x)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// An unevenly lit image: a checkerboard of 4x4 squares, lit brightly on the
+// left and fading to dim on the right. The dark squares on the left are
+// brighter than the light squares on the right.
+cv::Mat MakeUnevenImage() {
+  cv::Mat image(32, 64, CV_8UC1);
+  for (int y = 0; y < image.rows; ++y) {
+    for (int x = 0; x < image.cols; ++x) {
+      const bool dark = ((x / 4) + (y / 4)) % 2;
+      const double light = 1.0 - 0.6 * x / (image.cols - 1);
+      image.at<unsigned char>(y, x) = (dark ? 140 : 240) * light;
+    }
+  }
+  return image;
+}
+
+TEST(BinarizerTest, Global) {
+  cv::Mat image = MakeUnevenImage();
+  cv::Mat out;
+  GlobalBinarizer().Binarize(image, out);
+
+  // Everything on the left is lighter than 127, and everything on the right is
+  // darker.
+  EXPECT_EQ(255, out.at<unsigned char>(0, 0));
+  EXPECT_EQ(255, out.at<unsigned char>(0, 4));
+  EXPECT_EQ(0, out.at<unsigned char>(0, 56));
+  EXPECT_EQ(0, out.at<unsigned char>(0, 60));
+}
+
+TEST(BinarizerTest, LocalMean) {
+  cv::Mat image = MakeUnevenImage();
+  cv::Mat out;
+  LocalMeanBinarizer(9, 15, 1).Binarize(image, out);
+
+  for (int y = 0; y < image.rows; ++y) {
+    for (int x = 0; x < image.cols; ++x) {
+      const bool dark = ((x / 4) + (y / 4)) % 2;
+      EXPECT_EQ(dark ? 0 : 255, out.at<unsigned char>(y, x))
+          << "x " << x << " y " << y;
+    }
+  }
+}
+
+// Threaded and in-place binarization must match a single-threaded run into a
+// separate Mat.
+TEST(BinarizerTest, LocalMeanThreadedInPlace) {
+  const cv::Mat image = MakeUnevenImage();
+  cv::Mat expected;
+  LocalMeanBinarizer(9, 15, 1).Binarize(image, expected);
+
+  for (int num_threads : {2, 3, 64}) {
+    cv::Mat out = image.clone();
+    LocalMeanBinarizer(9, 15, num_threads).Binarize(out, out);
+    EXPECT_TRUE(SameImage(expected, out)) << num_threads;
+  }
+}
+
+TEST(BinarizerTest, MakeBinarizer) {
+  EXPECT_NE(nullptr, MakeBinarizer("global", 1));
+  EXPECT_NE(nullptr, MakeBinarizer("local", 4));
+  EXPECT_EQ(nullptr, MakeBinarizer("bogus", 1));
+}
+
+}  // namespace
@@ -0,0 +1,87 @@
+#include "qrcode/bit_image.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "opencv2/opencv.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+BitImage::BitImage(int width, int height)
+    : width_(width),
+      height_(height),
+      words_per_row_((width + 63) / 64),
+      words_(words_per_row_ * height) {}
+
+void BitImage::Set(int x, int y, bool val) {
+  const uint64_t bit = uint64_t{1} << (x % 64);
+  uint64_t* word = &MutableRow(y)[x / 64];
+  if (val) {
+    *word |= bit;
+  } else {
+    *word &= ~bit;
+  }
+}
+
+int BitImage::RowRunLength(int x, int y) const {
+  const uint64_t* row = Row(y);
+  const int max_len = width_ - x;
+
+  // XORing each word with the starting pixel's value leaves set bits only for
+  // the pixels that differ from it, so the first set bit ends the run. Padding
+  // bits may end a white run early (or, being clear, fail to end a black one),
+  // which the clamp to max_len takes care of.
+  const uint64_t flip = Get(x, y) ? ~uint64_t{0} : 0;
+
+  int word = x / 64;
+  const uint64_t ends = (row[word] ^ flip) >> (x % 64);
+  if (ends != 0) {
+    return std::min(__builtin_ctzll(ends), max_len);
+  }
+
+  for (++word; word < words_per_row_; ++word) {
+    const uint64_t ends = row[word] ^ flip;
+    if (ends != 0) {
+      return std::min(word * 64 + __builtin_ctzll(ends) - x, max_len);
+    }
+  }
+
+  return max_len;
+}
+
+std::unique_ptr<BitImage> BitImageFromGrayImage(const cv::Mat& image,
+                                                unsigned char threshold) {
+  auto out = absl::make_unique<BitImage>(image.cols, image.rows);
+  if (threshold == 255) {
+    return out;  // nothing is greater than 255
+  }
+
+  for (int y = 0; y < image.rows; ++y) {
+    const unsigned char* in = image.ptr<unsigned char>(y);
+    uint64_t* row = out->MutableRow(y);
+    int x = 0;
+
+#if defined(__SSE2__)
+    // SSE2 has no unsigned byte comparison, but px > threshold exactly when
+    // max(px, threshold + 1) == px. Blocks of 16 never straddle a word.
+    const __m128i min = _mm_set1_epi8(static_cast<char>(threshold + 1));
+    for (; x + 16 <= image.cols; x += 16) {
+      const __m128i px =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+      const uint64_t set = static_cast<uint16_t>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(px, min), px)));
+      row[x / 64] |= set << (x % 64);
+    }
+#endif
+
+    for (; x < image.cols; ++x) {
+      if (in[x] > threshold) {
+        row[x / 64] |= uint64_t{1} << (x % 64);
+      }
+    }
+  }
+
+  return out;
+}
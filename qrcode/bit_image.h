@@ -0,0 +1,99 @@
+#ifndef _QRCODE_BIT_IMAGE_H_
+#define _QRCODE_BIT_IMAGE_H_ 1
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "qrcode/pixel_iterator.h"
+#include "qrcode/point.h"
+
+namespace cv {
+class Mat;
+}  // namespace cv
+
+// A black-and-white image stored one bit per pixel, which is an eighth of the
+// size of the equivalent 8-bit cv::Mat.
+//
+// Each row is stored in 64-bit words, padded out to a whole word. Pixel x of a
+// row is bit x % 64 of word x / 64. Set bits are non-zero (white) pixels and
+// clear bits are zero (black), so padding bits are always clear.
+class BitImage {
+ public:
+  // Creates an all-black image.
+  BitImage(int width, int height);
+  ~BitImage() = default;
+
+  BitImage(const BitImage&) = delete;
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  bool Get(int x, int y) const { return (Row(y)[x / 64] >> (x % 64)) & 1; }
+  void Set(int x, int y, bool val);
+
+  // Returns the length of the run that starts at {x, y} and continues to the
+  // right, stopping at the end of the row.
+  int RowRunLength(int x, int y) const;
+
+  int words_per_row() const { return words_per_row_; }
+  const uint64_t* Row(int y) const { return &words_[y * words_per_row_]; }
+  uint64_t* MutableRow(int y) { return &words_[y * words_per_row_]; }
+
+ private:
+  const int width_, height_, words_per_row_;
+  std::vector<uint64_t> words_;
+};
+
+// Thresholds a single-channel 8-bit image. As with cv::threshold's
+// THRESH_BINARY, pixels greater than threshold are set.
+std::unique_ptr<BitImage> BitImageFromGrayImage(const cv::Mat& image,
+                                                unsigned char threshold);
+
+// A PixelIterator for BitImages. Get returns 0 or 255, as it would for a
+// black-and-white cv::Mat, so the iterators it makes can be used with
+// FixedRunner.
+class BitPixelIterator {
+ public:
+  explicit BitPixelIterator(const BitImage* image)
+      : x_(0), y_(0), image_(image) {}
+  ~BitPixelIterator() = default;
+
+  bool Seek(int x, int y) {
+    if (y < 0 || y >= image_->height() || x < 0 || x >= image_->width()) {
+      return false;
+    }
+
+    x_ = x;
+    y_ = y;
+    return true;
+  }
+
+  bool RelSeek(int delta_x, int delta_y) {
+    return Seek(x_ + delta_x, y_ + delta_y);
+  }
+
+  bool Seek(Point p) { return Seek(p.x, p.y); }
+
+  unsigned char Get() { return image_->Get(x_, y_) ? 255 : 0; }
+
+  // See PixelIterator::ForwardRowRunLength.
+  int ForwardRowRunLength(int* remaining) {
+    *remaining = image_->width() - x_;
+    return image_->RowRunLength(x_, y_);
+  }
+
+  using Directional =
+      DirectionalIterator<const unsigned char, BitPixelIterator>;
+
+  Directional MakeForwardRowIterator() { return Directional(*this, 1, 0); }
+  Directional MakeReverseRowIterator() { return Directional(*this, -1, 0); }
+  Directional MakeForwardColumnIterator() { return Directional(*this, 0, 1); }
+  Directional MakeReverseColumnIterator() { return Directional(*this, 0, -1); }
+
+ private:
+  int x_, y_;
+  const BitImage* image_;
+};
+
+#endif  // _QRCODE_BIT_IMAGE_H_
@@ -0,0 +1,120 @@
+#include "qrcode/bit_image.h"
+
+#include <random>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/pixel_iterator.h"
+#include "qrcode/runner.h"
+#include "qrcode/testutils.h"
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Optional;
+
+TEST(BitImageTest, GetSet) {
+  BitImage image(70, 2);
+  EXPECT_EQ(2, image.words_per_row());
+
+  for (int x : {0, 63, 64, 69}) {
+    EXPECT_FALSE(image.Get(x, 1)) << x;
+    image.Set(x, 1, true);
+    EXPECT_TRUE(image.Get(x, 1)) << x;
+    EXPECT_FALSE(image.Get(x, 0)) << x;
+  }
+
+  image.Set(63, 1, false);
+  EXPECT_FALSE(image.Get(63, 1));
+  EXPECT_TRUE(image.Get(64, 1));
+}
+
+TEST(BitImageTest, FromGrayImage) {
+  // Long enough to use both the vector and scalar paths.
+  std::vector<unsigned char> pixels(37);
+  for (int i = 0; i < pixels.size(); ++i) {
+    pixels[i] = i * 7;
+  }
+  cv::Mat gray(1, pixels.size(), CV_8UC1, pixels.data());
+
+  std::unique_ptr<BitImage> image = BitImageFromGrayImage(gray, 127);
+  for (int x = 0; x < pixels.size(); ++x) {
+    EXPECT_EQ(pixels[x] > 127, image->Get(x, 0)) << x;
+  }
+
+  image = BitImageFromGrayImage(gray, 255);
+  for (int x = 0; x < pixels.size(); ++x) {
+    EXPECT_FALSE(image->Get(x, 0)) << x;
+  }
+}
+
+TEST(BitImageTest, RowRunLength) {
+  // Runs that end inside words, on word boundaries, and at the end of a row
+  // that doesn't fill its last word.
+  const std::vector<int> lens = {1, 62, 1, 64, 5, 70, 2};
+  const std::vector<unsigned char> run = MakeRun(lens);
+  cv::Mat gray(1, run.size(), CV_8UC1, const_cast<unsigned char*>(run.data()));
+  std::unique_ptr<BitImage> image = BitImageFromGrayImage(gray, 0);
+
+  int x = 0;
+  for (int len : lens) {
+    EXPECT_EQ(len, image->RowRunLength(x, 0)) << x;
+    // Starting part way into a run.
+    EXPECT_EQ(1, image->RowRunLength(x + len - 1, 0)) << x;
+    x += len;
+  }
+}
+
+// Runners over a BitImage must see the same runs as over the equivalent
+// cv::Mat, in every direction.
+TEST(BitImageTest, MatchesPixelIterator) {
+  constexpr int kWidth = 150, kHeight = 40;
+  std::mt19937 gen(1);
+  std::bernoulli_distribution flip(0.1);
+  std::vector<unsigned char> pixels(kWidth * kHeight);
+  unsigned char val = 0;
+  for (unsigned char& pixel : pixels) {
+    if (flip(gen)) {
+      val = 255 - val;
+    }
+    pixel = val;
+  }
+  cv::Mat gray(kHeight, kWidth, CV_8UC1, pixels.data());
+  std::unique_ptr<BitImage> image = BitImageFromGrayImage(gray, 127);
+
+  PixelIterator<const unsigned char> mat_iter(pixels.data(), kWidth, kHeight);
+  BitPixelIterator bit_iter(image.get());
+
+  auto all_runs = [](auto iter) {
+    FixedRunner<1, decltype(iter)> runner(iter);
+    std::vector<int> runs;
+    for (;;) {
+      auto run = runner.Next(1, nullptr);
+      if (!run.has_value()) {
+        return runs;
+      }
+      runs.push_back((*run)[0]);
+    }
+  };
+
+  for (const Point& p : {Point(0, 0), Point(75, 20), Point(149, 39)}) {
+    ASSERT_TRUE(mat_iter.Seek(p));
+    ASSERT_TRUE(bit_iter.Seek(p));
+
+    EXPECT_EQ(all_runs(mat_iter.MakeForwardColumnIterator()),
+              all_runs(bit_iter.MakeForwardColumnIterator()));
+    EXPECT_EQ(all_runs(mat_iter.MakeReverseColumnIterator()),
+              all_runs(bit_iter.MakeReverseColumnIterator()));
+    EXPECT_EQ(all_runs(mat_iter.MakeForwardRowIterator()),
+              all_runs(bit_iter.MakeForwardRowIterator()));
+    EXPECT_EQ(all_runs(mat_iter.MakeReverseRowIterator()),
+              all_runs(bit_iter.MakeReverseRowIterator()));
+  }
+}
+
+}  // namespace
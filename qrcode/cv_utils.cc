@@ -4,18 +4,63 @@
 
 #include "absl/strings/str_format.h"
 
-bool ReadBwImage(const std::string& path, cv::OutputArray out) {
-  cv::Mat input = cv::imread(path, cv::IMREAD_COLOR);
-  if (!input.data) {
+namespace {
+
+// Returns the imread flags for a grayscale read at 1/reduction scale, or -1 if
+// imread doesn't support that reduction.
+int GrayscaleReadFlags(int reduction) {
+  switch (reduction) {
+    case 1:
+      return cv::IMREAD_GRAYSCALE;
+    case 2:
+      return cv::IMREAD_REDUCED_GRAYSCALE_2;
+    case 4:
+      return cv::IMREAD_REDUCED_GRAYSCALE_4;
+    case 8:
+      return cv::IMREAD_REDUCED_GRAYSCALE_8;
+    default:
+      return -1;
+  }
+}
+
+}  // namespace
+
+bool ReadGrayImage(const std::string& path, int reduction,
+                   cv::OutputArray out) {
+  const int flags = GrayscaleReadFlags(reduction);
+  if (flags < 0) {
+    std::cerr << absl::StrFormat("unsupported reduction %d\n", reduction);
     return false;
   }
 
+  // Have the decoder produce grayscale directly, rather than decoding to BGR
+  // and converting.
+  cv::Mat gray = cv::imread(path, flags);
+  if (!gray.data) {
+    return false;
+  }
+
+  out.getMatRef() = gray;
+  return true;
+}
+
+bool ReadBwImage(const std::string& path, cv::OutputArray out) {
+  return ReadBwImage(path, 1, out);
+}
+
+bool ReadBwImage(const std::string& path, int reduction, cv::OutputArray out) {
+  return ReadBwImage(path, reduction, GlobalBinarizer(), out);
+}
+
+bool ReadBwImage(const std::string& path, int reduction,
+                 const Binarizer& binarizer, cv::OutputArray out) {
+  // The gray image is the only full-size intermediate.
   cv::Mat gray;
-  cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
+  if (!ReadGrayImage(path, reduction, gray)) {
+    return false;
+  }
 
-  // NOTE: This needs to use the same threshold as the threshold()
-  // call in ExtractCode, which is awkward.
-  cv::threshold(gray, out, 127, 255, cv::THRESH_BINARY);
+  binarizer.Binarize(gray, out);
 
   if (out.depth() != CV_8U || out.channels() != 1 || !out.isContinuous()) {
     std::cerr << absl::StrFormat(
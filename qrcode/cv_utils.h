@@ -5,6 +5,22 @@
 
 #include "opencv2/opencv.hpp"
 
+#include "qrcode/binarizer.h"
+
+// Reads the image at path as grayscale, reduced by a factor of reduction (1,
+// 2, 4, or 8) in each dimension. The decoder does the grayscale conversion and
+// reduction.
+bool ReadGrayImage(const std::string& path, int reduction, cv::OutputArray out);
+
 bool ReadBwImage(const std::string& path, cv::OutputArray out);
 
+// Reads the image as ReadGrayImage does, and thresholds it into out using a
+// GlobalBinarizer. The threshold writes straight into out, reusing its buffer
+// if it's already the right size.
+bool ReadBwImage(const std::string& path, int reduction, cv::OutputArray out);
+
+// As above, but binarizes with binarizer rather than a global threshold.
+bool ReadBwImage(const std::string& path, int reduction,
+                 const Binarizer& binarizer, cv::OutputArray out);
+
 #endif  // _QRCODE_CV_UTILS_H_
@@ -0,0 +1,39 @@
+#include "qrcode/cv_utils.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+constexpr char kImageRelPath[] = "qrcode/testdata/straight.png";
+
+bool IsBlackAndWhite(const cv::Mat& image) {
+  for (int y = 0; y < image.rows; ++y) {
+    const unsigned char* row = image.ptr<unsigned char>(y);
+    for (int x = 0; x < image.cols; ++x) {
+      if (row[x] != 0 && row[x] != 255) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+TEST(ReadBwImageTest, Read) {
+  cv::Mat image;
+  ASSERT_TRUE(ReadBwImage(kImageRelPath, image));
+  EXPECT_TRUE(IsBlackAndWhite(image));
+
+  cv::Mat reduced;
+  ASSERT_TRUE(ReadBwImage(kImageRelPath, 2, reduced));
+  EXPECT_EQ(image.cols / 2, reduced.cols);
+  EXPECT_EQ(image.rows / 2, reduced.rows);
+  EXPECT_TRUE(IsBlackAndWhite(reduced));
+}
+
+TEST(ReadBwImageTest, Errors) {
+  cv::Mat image;
+  EXPECT_FALSE(ReadBwImage(kImageRelPath, 3, image));
+  EXPECT_FALSE(ReadBwImage("qrcode/testdata/missing.png", image));
+}
+
+}  // namespace
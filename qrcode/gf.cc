@@ -1,202 +1,220 @@
 #include "qrcode/gf.h"
 
+#include <cassert>
+
 #include <bitset>
 #include <sstream>
 
-#include "absl/base/macros.h"
+// The vector kernels are compiled for AVX2 whatever the compiler's target,
+// and only called if the CPU turns out to support it.
+#if defined(__x86_64__) || defined(__i386__)
+#define QRCODE_GF_AVX2 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+const FastGF256::Tables FastGF256::kTables = FastGF256::MakeTables();
+
+namespace {
 
-constexpr unsigned char GF16::kPowersOfAlpha[];
-constexpr unsigned char GF16::kElements[];
-constexpr unsigned char GF16::kElementsToPowers[];
+#ifdef QRCODE_GF_AVX2
 
-const std::vector<unsigned char>& GF16::PowersOfAlpha() const {
-  static const std::vector<unsigned char> kVec(
-      kPowersOfAlpha, kPowersOfAlpha + ABSL_ARRAYSIZE(kPowersOfAlpha));
-  return kVec;
+constexpr int kLanes = 32;
+
+// Multiplication by c, split by nibble: c*x = lo[x & 0xf] ^ hi[x >> 4]. Each
+// 16-entry table is repeated in both halves of the register because PSHUFB
+// shuffles within 128-bit lanes.
+struct NibbleTables {
+  __m256i lo, hi;
+};
+
+AVX2_TARGET NibbleTables MakeNibbleTables(const FastGF256& gf,
+                                          unsigned char c) {
+  alignas(16) unsigned char lo[16], hi[16];
+  for (int i = 0; i < 16; ++i) {
+    lo[i] = gf.Mult(c, i);
+    hi[i] = gf.Mult(c, i << 4);
+  }
+  return {_mm256_broadcastsi128_si256(
+              _mm_load_si128(reinterpret_cast<const __m128i*>(lo))),
+          _mm256_broadcastsi128_si256(
+              _mm_load_si128(reinterpret_cast<const __m128i*>(hi)))};
 }
 
-const std::vector<unsigned char>& GF16::Elements() const {
-  static const std::vector<unsigned char> kVec(
-      kElements, kElements + ABSL_ARRAYSIZE(kElements));
-  return kVec;
+AVX2_TARGET __m256i MultConstant(const NibbleTables& tables, __m256i x) {
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  const __m256i lo = _mm256_and_si256(x, mask);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), mask);
+  return _mm256_xor_si256(_mm256_shuffle_epi8(tables.lo, lo),
+                          _mm256_shuffle_epi8(tables.hi, hi));
 }
 
-unsigned char GF16::Add(std::initializer_list<unsigned char> elems) const {
-  // Addition is defined as bitwise XOR.
-  auto iter = elems.begin();
-  if (iter == elems.end()) {
-    return 0;
-  }
-  unsigned char res = *iter;
-  for (++iter; iter != elems.end(); ++iter) {
-    res = res ^ *iter;
+// Multiplies corresponding elements of a and b. Neither is constant, so
+// there's no table to shuffle through. Instead, add a*x^k for each bit k set
+// in b, doubling a (multiplying it by x, modulo the field polynomial) each
+// time.
+AVX2_TARGET __m256i MultVectors(__m256i a, __m256i b) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i reduce = _mm256_set1_epi8(0x1d);
+  __m256i res = zero;
+  for (int k = 0; k < 8; ++k) {
+    // BLENDV selects by each byte's top bit, so move bit k there. The 16-bit
+    // shift doesn't carry anything into the top bit of the high byte.
+    const __m256i bit = _mm256_slli_epi16(b, 7 - k);
+    res = _mm256_xor_si256(res, _mm256_blendv_epi8(zero, a, bit));
+    const __m256i overflow = _mm256_blendv_epi8(zero, reduce, a);
+    a = _mm256_xor_si256(_mm256_add_epi8(a, a), overflow);
   }
   return res;
 }
 
-unsigned char GF16::Mult(unsigned char m1, unsigned char m2) const {
-  const unsigned char a = m1 & 1, b = m1 & 2;
-  const unsigned char c = m1 & 4, d = m1 & 8;
-  const unsigned char e = m2 & 1, f = m2 & 2;
-  const unsigned char g = m2 & 4, h = m2 & 8;
-
-  // Given two polynomials in GF(2^4)
-  //   a + b*alpha + c*alpha^2 + d*alpha^3
-  //   e + f*alpha + g*alpha^2 + h*alpha^3
-  // multiplication is defined as:
-  //   (ae+bh+cg+df) +
-  //   (af+be+bh+cg+df+ch+dg) * alpha +
-  //   (ag+bf+ce+ch+dg+dh) * alpha^2 +
-  //   (ah+bg+cf+de+dh) * alpha^3
-  // Source: https://en.wikipedia.org/wiki/Finite_field#GF(16)
-  //
-  // Operations on the coefficients (i.e. a-h) are performed in
-  // GF(2). GF(2) addition and multiplication are bitwise XOR and
-  // AND, respectively.
-
-  const unsigned char out_a = (a && e) ^ (b && h) ^ (c && g) ^ (d && f);
-  const unsigned char out_b = (a && f) ^ (b && e) ^ (b && h) ^ (c && g) ^
-                              (d && f) ^ (c && h) ^ (d && g);
-  const unsigned char out_c =
-      (a && g) ^ (b && f) ^ (c && e) ^ (c && h) ^ (d && g) ^ (d && h);
-  const unsigned char out_d =
-      (a && h) ^ (b && g) ^ (c && f) ^ (d && e) ^ (d && h);
-
-  return ((out_d & 1) << 3) | ((out_c & 1) << 2) | ((out_b & 1) << 1) |
-         (out_a & 1);
+AVX2_TARGET __m256i Load(const unsigned char* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
 }
 
-unsigned char GF16::Inverse(unsigned char x) const { return kInverse[x]; }
+AVX2_TARGET void Store(__m256i v, unsigned char* p) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
 
-unsigned char GF16::Pow(unsigned char x, int y) const {
-  if (y == 0) {
-    return 1;
-  } else if (x == 0) {
-    return 0;
+// Does FastGF256::MultAdd for as many whole vectors as fit, returning the
+// number of elements done.
+AVX2_TARGET int MultAddAvx2(const FastGF256& gf, unsigned char c,
+                            absl::Span<const unsigned char> src,
+                            absl::Span<unsigned char> dst) {
+  const NibbleTables tables = MakeNibbleTables(gf, c);
+  int i = 0;
+  for (; i + kLanes <= src.size(); i += kLanes) {
+    Store(_mm256_xor_si256(Load(&dst[i]), MultConstant(tables, Load(&src[i]))),
+          &dst[i]);
   }
-  return kPowersOfAlpha[(kElementsToPowers[x] * y) % 15];
+  return i;
 }
 
-unsigned char GF16::AlphaPow(int y) const { return kPowersOfAlpha[y % 15]; }
+// Does FastGF256::EvalPoly for a poly with at least kLanes coefficients.
+//
+// Deal the coefficients out to the lanes, so lane l accumulates the
+// coefficients c_l, c_{l+32}, ... by Horner's rule with a step of p^32.
+// Padding the front of poly with zeros so its length is a multiple of 32
+// doesn't change its value. Horner's rule then combines the lanes, which hold
+// the coefficients of p^31 through p^0.
+AVX2_TARGET void EvalPolyAvx2(const FastGF256& gf,
+                              absl::Span<const unsigned char> poly,
+                              absl::Span<const unsigned char> points,
+                              absl::Span<unsigned char> out) {
+  const int pad = (kLanes - poly.size() % kLanes) % kLanes;
+  alignas(32) unsigned char first[kLanes] = {};
+  for (int i = pad; i < kLanes; ++i) {
+    first[i] = poly[i - pad];
+  }
 
-int GF16::ToAlphaPow(unsigned char x) const { return kElementsToPowers[x]; }
+  for (int j = 0; j < points.size(); ++j) {
+    const NibbleTables tables = MakeNibbleTables(gf, gf.Pow(points[j], 32));
+    __m256i acc = Load(first);
+    for (int i = kLanes - pad; i < poly.size(); i += kLanes) {
+      acc = _mm256_xor_si256(MultConstant(tables, acc), Load(&poly[i]));
+    }
 
-const unsigned char GF16::kInverse[16] = {0,  1, 9,  14, 13, 11, 7, 6,
-                                          15, 2, 12, 5,  10, 4,  3, 8};
+    alignas(32) unsigned char lanes[kLanes];
+    Store(acc, lanes);
+    unsigned char res = 0;
+    for (const unsigned char lane : lanes) {
+      res = gf.Mult(res, points[j]) ^ lane;
+    }
+    out[j] = res;
+  }
+}
 
-constexpr unsigned char GF256::kPowersOfAlpha[];
-constexpr unsigned char GF256::kElements[];
-constexpr unsigned char GF256::kElementsToPowers[];
+// Does FastGF256::DotProduct for as many whole vectors as fit, returning the
+// number of elements done. Their sum is stored in *res.
+AVX2_TARGET int DotProductAvx2(absl::Span<const unsigned char> a,
+                               absl::Span<const unsigned char> b,
+                               unsigned char* res) {
+  __m256i acc = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + kLanes <= a.size(); i += kLanes) {
+    acc = _mm256_xor_si256(acc, MultVectors(Load(&a[i]), Load(&b[i])));
+  }
 
-const std::vector<unsigned char>& GF256::PowersOfAlpha() const {
-  static const std::vector<unsigned char> kVec(
-      kPowersOfAlpha, kPowersOfAlpha + ABSL_ARRAYSIZE(kPowersOfAlpha));
-  return kVec;
+  alignas(32) unsigned char lanes[kLanes];
+  Store(acc, lanes);
+  *res = 0;
+  for (const unsigned char lane : lanes) {
+    *res ^= lane;
+  }
+  return i;
 }
 
-const std::vector<unsigned char>& GF256::Elements() const {
-  static const std::vector<unsigned char> kVec(
-      kElements, kElements + ABSL_ARRAYSIZE(kElements));
-  return kVec;
+#endif  // QRCODE_GF_AVX2
+
+bool CpuHasAvx2() {
+#ifdef QRCODE_GF_AVX2
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
 }
 
-unsigned char GF256::Add(std::initializer_list<unsigned char> elems) const {
-  // Addition is defined as bitwise XOR.
-  auto iter = elems.begin();
-  if (iter == elems.end()) {
-    return 0;
+}  // namespace
+
+FastGF256::FastGF256(bool use_simd) : simd_(use_simd && CpuHasAvx2()) {}
+
+void FastGF256::MultAdd(unsigned char c, absl::Span<const unsigned char> src,
+                        absl::Span<unsigned char> dst) const {
+  assert(src.size() == dst.size());
+  if (c == 0) {
+    return;
   }
-  unsigned char res = *iter;
-  for (++iter; iter != elems.end(); ++iter) {
-    res = res ^ *iter;
+
+  int i = 0;
+#ifdef QRCODE_GF_AVX2
+  if (simd_) {
+    i = MultAddAvx2(*this, c, src, dst);
   }
-  return res;
-}
+#endif
 
-unsigned char GF256::Mult(unsigned char m1, unsigned char m2) const {
-  const unsigned char a = m1 & 1, i = m2 & 1;
-  const unsigned char b = m1 & 2, j = m2 & 2;
-  const unsigned char c = m1 & 4, k = m2 & 4;
-  const unsigned char d = m1 & 8, l = m2 & 8;
-  const unsigned char e = m1 & 16, m = m2 & 16;
-  const unsigned char f = m1 & 32, n = m2 & 32;
-  const unsigned char g = m1 & 64, o = m2 & 64;
-  const unsigned char h = m1 & 128, p = m2 & 128;
-
-  unsigned char out_a = (a && i) ^ (b && p) ^ (c && o) ^ (d && n) ^ (e && m) ^
-                        (f && l) ^ (f && p) ^ (g && k) ^ (g && o) ^ (g && p) ^
-                        (h && j) ^ (h && n) ^ (h && o) ^ (h && p);
-  unsigned char out_b = (a && j) ^ (b && i) ^ (c && p) ^ (d && o) ^ (e && n) ^
-                        (f && m) ^ (g && l) ^ (g && p) ^ (h && k) ^ (h && o) ^
-                        (h && p);
-  unsigned char out_c = (a && k) ^ (b && j) ^ (b && p) ^ (c && i) ^ (c && o) ^
-                        (d && n) ^ (d && p) ^ (e && m) ^ (e && o) ^ (f && l) ^
-                        (f && n) ^ (f && p) ^ (g && k) ^ (g && m) ^ (g && o) ^
-                        (g && p) ^ (h && j) ^ (h && l) ^ (h && n) ^ (h && o);
-  unsigned char out_d = (a && l) ^ (b && k) ^ (b && p) ^ (c && j) ^ (c && o) ^
-                        (c && p) ^ (d && i) ^ (d && n) ^ (d && o) ^ (e && m) ^
-                        (e && n) ^ (e && p) ^ (f && l) ^ (f && m) ^ (f && o) ^
-                        (f && p) ^ (g && k) ^ (g && l) ^ (g && n) ^ (g && o) ^
-                        (h && j) ^ (h && k) ^ (h && m) ^ (h && n);
-  unsigned char out_e = (a && m) ^ (b && l) ^ (b && p) ^ (c && k) ^ (c && o) ^
-                        (c && p) ^ (d && j) ^ (d && n) ^ (d && o) ^ (d && p) ^
-                        (e && i) ^ (e && m) ^ (e && n) ^ (e && o) ^ (f && l) ^
-                        (f && m) ^ (f && n) ^ (g && k) ^ (g && l) ^ (g && m) ^
-                        (h && j) ^ (h && k) ^ (h && l) ^ (h && p);
-  unsigned char out_f = (a && n) ^ (b && m) ^ (c && l) ^ (c && p) ^ (d && k) ^
-                        (d && o) ^ (d && p) ^ (e && j) ^ (e && n) ^ (e && o) ^
-                        (e && p) ^ (f && i) ^ (f && m) ^ (f && n) ^ (f && o) ^
-                        (g && l) ^ (g && m) ^ (g && n) ^ (h && k) ^ (h && l) ^
-                        (h && m);
-  unsigned char out_g = (a && o) ^ (b && n) ^ (c && m) ^ (d && l) ^ (d && p) ^
-                        (e && k) ^ (e && o) ^ (e && p) ^ (f && j) ^ (f && n) ^
-                        (f && o) ^ (f && p) ^ (g && i) ^ (g && m) ^ (g && n) ^
-                        (g && o) ^ (h && l) ^ (h && m) ^ (h && n);
-  unsigned char out_h = (a && p) ^ (b && o) ^ (c && n) ^ (d && m) ^ (e && l) ^
-                        (e && p) ^ (f && k) ^ (f && o) ^ (f && p) ^ (g && j) ^
-                        (g && n) ^ (g && o) ^ (g && p) ^ (h && i) ^ (h && m) ^
-                        (h && n) ^ (h && o);
-
-  return ((out_h & 1) << 7) | ((out_g & 1) << 6) | ((out_f & 1) << 5) |
-         ((out_e & 1) << 4) | ((out_d & 1) << 3) | ((out_c & 1) << 2) |
-         ((out_b & 1) << 1) | (out_a & 1);
+  for (; i < src.size(); ++i) {
+    dst[i] ^= Mult(c, src[i]);
+  }
 }
 
-unsigned char GF256::Inverse(unsigned char x) const { return kInverse[x]; }
+void FastGF256::EvalPoly(absl::Span<const unsigned char> poly,
+                         absl::Span<const unsigned char> points,
+                         absl::Span<unsigned char> out) const {
+  assert(points.size() == out.size());
+
+#ifdef QRCODE_GF_AVX2
+  if (simd_ && poly.size() >= kLanes) {
+    EvalPolyAvx2(*this, poly, points, out);
+    return;
+  }
+#endif
 
-unsigned char GF256::Pow(unsigned char x, int y) const {
-  if (y == 0) {
-    return 1;
-  } else if (x == 0) {
-    return 0;
+  for (int j = 0; j < points.size(); ++j) {
+    unsigned char res = 0;
+    for (const unsigned char c : poly) {
+      res = Mult(res, points[j]) ^ c;
+    }
+    out[j] = res;
   }
-  return kPowersOfAlpha[(kElementsToPowers[x] * y) % 255];
 }
 
-unsigned char GF256::AlphaPow(int y) const { return kPowersOfAlpha[y % 255]; }
-
-int GF256::ToAlphaPow(unsigned char x) const { return kElementsToPowers[x]; }
-
-const unsigned char GF256::kInverse[256] = {
-    0,   1,   142, 244, 71,  167, 122, 186, 173, 157, 221, 152, 61,  170, 93,
-    150, 216, 114, 192, 88,  224, 62,  76,  102, 144, 222, 85,  128, 160, 131,
-    75,  42,  108, 237, 57,  81,  96,  86,  44,  138, 112, 208, 31,  74,  38,
-    139, 51,  110, 72,  137, 111, 46,  164, 195, 64,  94,  80,  34,  207, 169,
-    171, 12,  21,  225, 54,  95,  248, 213, 146, 78,  166, 4,   48,  136, 43,
-    30,  22,  103, 69,  147, 56,  35,  104, 140, 129, 26,  37,  97,  19,  193,
-    203, 99,  151, 14,  55,  65,  36,  87,  202, 91,  185, 196, 23,  77,  82,
-    141, 239, 179, 32,  236, 47,  50,  40,  209, 17,  217, 233, 251, 218, 121,
-    219, 119, 6,   187, 132, 205, 254, 252, 27,  84,  161, 29,  124, 204, 228,
-    176, 73,  49,  39,  45,  83,  105, 2,   245, 24,  223, 68,  79,  155, 188,
-    15,  92,  11,  220, 189, 148, 172, 9,   199, 162, 28,  130, 159, 198, 52,
-    194, 70,  5,   206, 59,  13,  60,  156, 8,   190, 183, 135, 229, 238, 107,
-    235, 242, 191, 175, 197, 100, 7,   123, 149, 154, 174, 182, 18,  89,  165,
-    53,  101, 184, 163, 158, 210, 247, 98,  90,  133, 125, 168, 58,  41,  113,
-    200, 246, 249, 67,  215, 214, 16,  115, 118, 120, 153, 10,  25,  145, 20,
-    63,  230, 240, 134, 177, 226, 241, 250, 116, 243, 180, 109, 33,  178, 106,
-    227, 231, 181, 234, 3,   143, 211, 201, 66,  212, 232, 117, 127, 255, 126,
-    253,
-};
+unsigned char FastGF256::DotProduct(absl::Span<const unsigned char> a,
+                                    absl::Span<const unsigned char> b) const {
+  assert(a.size() == b.size());
+
+  unsigned char res = 0;
+  int i = 0;
+#ifdef QRCODE_GF_AVX2
+  if (simd_) {
+    i = DotProductAvx2(a, b, &res);
+  }
+#endif
+
+  for (; i < a.size(); ++i) {
+    res ^= Mult(a[i], b[i]);
+  }
+  return res;
+}
 
 std::string VecToString(const GF& gf, const std::vector<unsigned char>& vec) {
   std::stringstream ss;
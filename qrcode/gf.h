@@ -2,8 +2,11 @@
 #define _QRCODE_GF_H_ 1
 
 #include <initializer_list>
+#include <string>
 #include <vector>
 
+#include "absl/types/span.h"
+
 class GF {
  public:
   virtual ~GF() = default;
@@ -59,140 +62,268 @@ class GF {
   virtual int ToAlphaPow(unsigned char x) const = 0;
 };
 
-// Functions used to perform operations in GF(16), aka GF(2^4).
-// See also https://en.wikipedia.org/wiki/Finite_field#GF(16)
-class GF16 : public GF {
+class FastGF256;
+
+namespace gf_internal {
+
+// Lookup tables for arithmetic in GF(2^M).
+template <int M>
+struct Tables {
+  // alpha^0 through alpha^(2^M-2), stored bitwise as described in
+  // GF::PowersOfAlpha.
+  unsigned char powers[(1 << M) - 1];
+
+  // The inverse of powers:
+  //
+  //   logs[powers[x]] = x
+  //
+  // NOTE: logs[0] holds a sentinel, 255, because there is no power of alpha
+  // equal to zero.
+  unsigned char logs[1 << M];
+
+  // Multiplicative inverses of non-zero elements. inverses[0] is 0.
+  unsigned char inverses[1 << M];
+};
+
+// Returns true if the powers of alpha generated by poly visit every non-zero
+// element of GF(2^m) before returning to 1.
+constexpr bool IsPrimitive(int m, unsigned poly) {
+  const int order = (1 << m) - 1;
+  unsigned val = 1;
+  for (int i = 1; i <= order; ++i) {
+    val <<= 1;
+    if (val & (1u << m)) {
+      val ^= poly;
+    }
+    if (val == 1) {
+      return i == order;
+    }
+  }
+  return false;
+}
+
+template <int M, unsigned Poly>
+constexpr Tables<M> MakeTables() {
+  constexpr int kOrder = (1 << M) - 1;
+  Tables<M> tables = {};
+  unsigned val = 1;
+  for (int i = 0; i < kOrder; ++i) {
+    tables.powers[i] = val;
+    tables.logs[val] = i;
+    val <<= 1;
+    if (val & (1u << M)) {
+      val ^= Poly;
+    }
+  }
+  tables.logs[0] = 255;
+
+  for (int i = 0; i < kOrder; ++i) {
+    tables.inverses[tables.powers[i]] = tables.powers[(kOrder - i) % kOrder];
+  }
+  return tables;
+}
+
+}  // namespace gf_internal
+
+// Arithmetic in GF(2^M), whose elements are polynomials with coefficients in
+// GF(2) reduced modulo the primitive polynomial Poly. Poly is stored bitwise,
+// so x^4+x+1 is 0x13. The tables that implement the arithmetic are generated
+// at compile time.
+template <int M, unsigned Poly>
+class GaloisField : public GF {
  public:
-  ~GF16() override = default;
+  static_assert(M >= 2 && M <= 8, "elements must fit in an unsigned char");
+  static_assert((Poly >> M) == 1, "Poly must have degree M");
+  static_assert(gf_internal::IsPrimitive(M, Poly), "Poly must be primitive");
 
-  int m() const override { return 4; }
+  // The number of non-zero elements, and thus of distinct powers of alpha.
+  static constexpr int kOrder = (1 << M) - 1;
 
-  const std::vector<unsigned char>& PowersOfAlpha() const override;
-  const std::vector<unsigned char>& Elements() const override;
+  ~GaloisField() override = default;
 
-  unsigned char Add(std::initializer_list<unsigned char> elems) const override;
-  unsigned char Mult(unsigned char m1, unsigned char m2) const override;
-  unsigned char Inverse(unsigned char x) const override;
-  unsigned char Pow(unsigned char x, int y) const override;
-  unsigned char AlphaPow(int y) const override;
-  int ToAlphaPow(unsigned char x) const override;
+  int m() const override { return M; }
 
- private:
-  static const unsigned char kInverse[16];
+  const std::vector<unsigned char>& PowersOfAlpha() const override {
+    static const std::vector<unsigned char> kVec(
+        kTables.powers, kTables.powers + kOrder);
+    return kVec;
+  }
 
-  static constexpr unsigned char kPowersOfAlpha[15] = {
-      1, 2, 4, 8, 3, 6, 12, 11, 5, 10, 7, 14, 15, 13, 9,
-  };
+  const std::vector<unsigned char>& Elements() const override {
+    static const std::vector<unsigned char> kVec = [] {
+      std::vector<unsigned char> elements(kTables.powers,
+                                          kTables.powers + kOrder);
+      elements.push_back(0);
+      return elements;
+    }();
+    return kVec;
+  }
 
-  static constexpr unsigned char kElements[16] = {
-      1, 2, 4, 8, 3, 6, 12, 11, 5, 10, 7, 14, 15, 13, 9, 0,
-  };
+  unsigned char Add(std::initializer_list<unsigned char> elems) const override {
+    // Addition is defined as bitwise XOR.
+    unsigned char res = 0;
+    for (const unsigned char elem : elems) {
+      res ^= elem;
+    }
+    return res;
+  }
 
-  // This array maps the elements that correspond to powers of alpha
-  // back to the powers of alpha. The following relationship holds between this
-  // array and kPowersOfAlpha:
-  //
-  //   kElementsToPowers[kPowersOfAlpha[x]] = x
-  //
-  // NOTE: This array contains a sentinel value at index 0 because there is no
-  // power of alpha equal to zero.
-  static constexpr unsigned char kElementsToPowers[16] = {
-      255, 0, 1, 4, 2, 8, 5, 10, 3, 14, 9, 7, 6, 13, 11, 12,
-  };
+  unsigned char Mult(unsigned char m1, unsigned char m2) const override {
+    return Product(m1, m2);
+  }
+
+  unsigned char Inverse(unsigned char x) const override {
+    return Reciprocal(x);
+  }
+
+  unsigned char Pow(unsigned char x, int y) const override {
+    if (y == 0) {
+      return 1;
+    } else if (x == 0) {
+      return 0;
+    }
+    return kTables.powers[(kTables.logs[x] * y) % kOrder];
+  }
+
+  unsigned char AlphaPow(int y) const override {
+    return kTables.powers[y % kOrder];
+  }
+
+  int ToAlphaPow(unsigned char x) const override { return kTables.logs[x]; }
+
+  // Compile-time equivalents of Mult and Inverse, for constants.
+  static constexpr unsigned char Product(unsigned char m1, unsigned char m2) {
+    if (m1 == 0 || m2 == 0) {
+      return 0;
+    }
+    return kTables.powers[(kTables.logs[m1] + kTables.logs[m2]) % kOrder];
+  }
+
+  static constexpr unsigned char Reciprocal(unsigned char x) {
+    return kTables.inverses[x];
+  }
+
+ private:
+  using Tables = gf_internal::Tables<M>;
+
+  static constexpr Tables kTables = gf_internal::MakeTables<M, Poly>();
+
+  friend class FastGF256;
 };
 
-// Functions used to perform operations in GF(256), aka GF(2^8).
-class GF256 : public GF {
+template <int M, unsigned Poly>
+constexpr int GaloisField<M, Poly>::kOrder;
+
+template <int M, unsigned Poly>
+constexpr typename GaloisField<M, Poly>::Tables GaloisField<M, Poly>::kTables;
+
+// GF(16), aka GF(2^4), generated by x^4+x+1.
+// See also https://en.wikipedia.org/wiki/Finite_field#GF(16)
+using GF16 = GaloisField<4, 0x13>;
+
+// GF(256), aka GF(2^8), generated by x^8+x^4+x^3+x^2+1.
+using GF256 = GaloisField<8, 0x11d>;
+
+// GF(256) arithmetic with the same interface as GF256. It isn't a GF: the
+// methods are non-virtual so they can be inlined into callers that take the
+// field as a template parameter (like DecodeRS), which matters in inner
+// loops.
+class FastGF256 {
  public:
-  ~GF256() override = default;
+  // The bulk operations below use vector instructions if use_simd is true and
+  // the CPU supports them. Tests turn use_simd off to cover the scalar
+  // versions too.
+  explicit FastGF256(bool use_simd = true);
 
-  int m() const override { return 8; }
+  int m() const { return 8; }
 
-  const std::vector<unsigned char>& PowersOfAlpha() const override;
-  const std::vector<unsigned char>& Elements() const override;
+  unsigned char Add(std::initializer_list<unsigned char> elems) const {
+    unsigned char res = 0;
+    for (const unsigned char elem : elems) {
+      res ^= elem;
+    }
+    return res;
+  }
 
-  unsigned char Add(std::initializer_list<unsigned char> elems) const override;
-  unsigned char Mult(unsigned char m1, unsigned char m2) const override;
-  unsigned char Inverse(unsigned char x) const override;
-  unsigned char Pow(unsigned char x, int y) const override;
-  unsigned char AlphaPow(int y) const override;
-  int ToAlphaPow(unsigned char x) const override;
+  unsigned char Sub(std::initializer_list<unsigned char> elems) const {
+    return Add(elems);
+  }
+
+  unsigned char Mult(unsigned char m1, unsigned char m2) const {
+    if (m1 == 0 || m2 == 0) {
+      return 0;
+    }
+    return kTables.exp[kTables.log[m1] + kTables.log[m2]];
+  }
+
+  // As with GF256, the inverse of zero is zero.
+  unsigned char Inverse(unsigned char x) const {
+    if (x == 0) {
+      return 0;
+    }
+    return kTables.exp[255 - kTables.log[x]];
+  }
+
+  unsigned char Pow(unsigned char x, int y) const {
+    if (y == 0) {
+      return 1;
+    } else if (x == 0) {
+      return 0;
+    }
+    return kTables.exp[(kTables.log[x] * y) % 255];
+  }
+
+  unsigned char AlphaPow(int y) const { return kTables.exp[y % 255]; }
+
+  int ToAlphaPow(unsigned char x) const { return kTables.log[x]; }
+
+  // Bulk operations on vectors of elements. On x86 CPUs with AVX2, these
+  // process 32 elements at a time, multiplying by a constant with a pair of
+  // 16-entry tables (one for each nibble) and PSHUFB. Otherwise they fall back
+  // to the table lookups above.
+
+  // dst[i] += c * src[i]. src and dst must be the same size.
+  void MultAdd(unsigned char c, absl::Span<const unsigned char> src,
+               absl::Span<unsigned char> dst) const;
+
+  // Evaluates the polynomial whose coefficients are in poly, highest degree
+  // first, at each of points, storing the results in out. points and out must
+  // be the same size.
+  void EvalPoly(absl::Span<const unsigned char> poly,
+                absl::Span<const unsigned char> points,
+                absl::Span<unsigned char> out) const;
+
+  // Returns the sum of a[i] * b[i]. a and b must be the same size.
+  unsigned char DotProduct(absl::Span<const unsigned char> a,
+                           absl::Span<const unsigned char> b) const;
+
+  // Returns true if the bulk operations use vector instructions.
+  bool simd() const { return simd_; }
 
  private:
-  static constexpr unsigned char kPowersOfAlpha[255] = {
-      1,   2,   4,   8,   16,  32,  64,  128, 29,  58,  116, 232, 205, 135, 19,
-      38,  76,  152, 45,  90,  180, 117, 234, 201, 143, 3,   6,   12,  24,  48,
-      96,  192, 157, 39,  78,  156, 37,  74,  148, 53,  106, 212, 181, 119, 238,
-      193, 159, 35,  70,  140, 5,   10,  20,  40,  80,  160, 93,  186, 105, 210,
-      185, 111, 222, 161, 95,  190, 97,  194, 153, 47,  94,  188, 101, 202, 137,
-      15,  30,  60,  120, 240, 253, 231, 211, 187, 107, 214, 177, 127, 254, 225,
-      223, 163, 91,  182, 113, 226, 217, 175, 67,  134, 17,  34,  68,  136, 13,
-      26,  52,  104, 208, 189, 103, 206, 129, 31,  62,  124, 248, 237, 199, 147,
-      59,  118, 236, 197, 151, 51,  102, 204, 133, 23,  46,  92,  184, 109, 218,
-      169, 79,  158, 33,  66,  132, 21,  42,  84,  168, 77,  154, 41,  82,  164,
-      85,  170, 73,  146, 57,  114, 228, 213, 183, 115, 230, 209, 191, 99,  198,
-      145, 63,  126, 252, 229, 215, 179, 123, 246, 241, 255, 227, 219, 171, 75,
-      150, 49,  98,  196, 149, 55,  110, 220, 165, 87,  174, 65,  130, 25,  50,
-      100, 200, 141, 7,   14,  28,  56,  112, 224, 221, 167, 83,  166, 81,  162,
-      89,  178, 121, 242, 249, 239, 195, 155, 43,  86,  172, 69,  138, 9,   18,
-      36,  72,  144, 61,  122, 244, 245, 247, 243, 251, 235, 203, 139, 11,  22,
-      44,  88,  176, 125, 250, 233, 207, 131, 27,  54,  108, 216, 173, 71,  142,
-  };
+  struct Tables {
+    // alpha^0 through alpha^509, so the sum of two logarithms can be looked
+    // up without reducing it mod 255.
+    unsigned char exp[510];
 
-  static constexpr unsigned char kElements[256] = {
-      1,   2,   4,   8,   16,  32,  64,  128, 29,  58,  116, 232, 205, 135, 19,
-      38,  76,  152, 45,  90,  180, 117, 234, 201, 143, 3,   6,   12,  24,  48,
-      96,  192, 157, 39,  78,  156, 37,  74,  148, 53,  106, 212, 181, 119, 238,
-      193, 159, 35,  70,  140, 5,   10,  20,  40,  80,  160, 93,  186, 105, 210,
-      185, 111, 222, 161, 95,  190, 97,  194, 153, 47,  94,  188, 101, 202, 137,
-      15,  30,  60,  120, 240, 253, 231, 211, 187, 107, 214, 177, 127, 254, 225,
-      223, 163, 91,  182, 113, 226, 217, 175, 67,  134, 17,  34,  68,  136, 13,
-      26,  52,  104, 208, 189, 103, 206, 129, 31,  62,  124, 248, 237, 199, 147,
-      59,  118, 236, 197, 151, 51,  102, 204, 133, 23,  46,  92,  184, 109, 218,
-      169, 79,  158, 33,  66,  132, 21,  42,  84,  168, 77,  154, 41,  82,  164,
-      85,  170, 73,  146, 57,  114, 228, 213, 183, 115, 230, 209, 191, 99,  198,
-      145, 63,  126, 252, 229, 215, 179, 123, 246, 241, 255, 227, 219, 171, 75,
-      150, 49,  98,  196, 149, 55,  110, 220, 165, 87,  174, 65,  130, 25,  50,
-      100, 200, 141, 7,   14,  28,  56,  112, 224, 221, 167, 83,  166, 81,  162,
-      89,  178, 121, 242, 249, 239, 195, 155, 43,  86,  172, 69,  138, 9,   18,
-      36,  72,  144, 61,  122, 244, 245, 247, 243, 251, 235, 203, 139, 11,  22,
-      44,  88,  176, 125, 250, 233, 207, 131, 27,  54,  108, 216, 173, 71,  142,
-      0,
+    // The inverse of exp, with the same sentinel at 0 as GF256's.
+    unsigned char log[256];
   };
 
-  // This array maps the elements that correspond to powers of alpha
-  // back to the powers of alpha. The following relationship holds between this
-  // array and kPowersOfAlpha:
-  //
-  //   kElementsToPowers[kPowersOfAlpha[x]] = x
-  //
-  // NOTE: This array contains a sentinel value at index 0 because there is no
-  // power of alpha equal to zero. This particular sentinel makes more sense for
-  // fields <2^8 when 255 isn't a valid member of the field.
-  static constexpr unsigned char kElementsToPowers[256] = {
-      255, 0,   1,   25,  2,   50,  26,  198, 3,   223, 51,  238, 27,  104, 199,
-      75,  4,   100, 224, 14,  52,  141, 239, 129, 28,  193, 105, 248, 200, 8,
-      76,  113, 5,   138, 101, 47,  225, 36,  15,  33,  53,  147, 142, 218, 240,
-      18,  130, 69,  29,  181, 194, 125, 106, 39,  249, 185, 201, 154, 9,   120,
-      77,  228, 114, 166, 6,   191, 139, 98,  102, 221, 48,  253, 226, 152, 37,
-      179, 16,  145, 34,  136, 54,  208, 148, 206, 143, 150, 219, 189, 241, 210,
-      19,  92,  131, 56,  70,  64,  30,  66,  182, 163, 195, 72,  126, 110, 107,
-      58,  40,  84,  250, 133, 186, 61,  202, 94,  155, 159, 10,  21,  121, 43,
-      78,  212, 229, 172, 115, 243, 167, 87,  7,   112, 192, 247, 140, 128, 99,
-      13,  103, 74,  222, 237, 49,  197, 254, 24,  227, 165, 153, 119, 38,  184,
-      180, 124, 17,  68,  146, 217, 35,  32,  137, 46,  55,  63,  209, 91,  149,
-      188, 207, 205, 144, 135, 151, 178, 220, 252, 190, 97,  242, 86,  211, 171,
-      20,  42,  93,  158, 132, 60,  57,  83,  71,  109, 65,  162, 31,  45,  67,
-      216, 183, 123, 164, 118, 196, 23,  73,  236, 127, 12,  111, 246, 108, 161,
-      59,  82,  41,  157, 85,  170, 251, 96,  134, 177, 187, 204, 62,  90,  203,
-      89,  95,  176, 156, 169, 160, 81,  11,  245, 22,  235, 122, 117, 44,  215,
-      79,  174, 213, 233, 230, 231, 173, 232, 116, 214, 244, 234, 168, 80,  88,
-      175,
-  };
+  static constexpr Tables MakeTables() {
+    Tables tables = {};
+    for (int i = 0; i < 510; ++i) {
+      tables.exp[i] = GF256::kTables.powers[i % 255];
+    }
+    for (int i = 0; i < 256; ++i) {
+      tables.log[i] = GF256::kTables.logs[i];
+    }
+    return tables;
+  }
+
+  static const Tables kTables;
 
-  // Contains multiplicative inverses for non-zero elements of the field.
-  //   kInverse[kPowersOfAlpha[x]] * kPowersOfAlpha[x] = 1
-  static const unsigned char kInverse[256];
+  const bool simd_;
 };
 
 // Returns a comma-delimited list of values from vec, with each value formatted
@@ -1,10 +1,50 @@
 #include "qrcode/gf_mat.h"
 
+#include <algorithm>
 #include <bitset>
 #include <iostream>
+#include <utility>
 
 #include "absl/memory/memory.h"
 
+constexpr int GFMat::kMaxInlineSize;
+
+unsigned char* GFMatArena::Allocate(int size) {
+  while (cur_ < blocks_.size() && blocks_[cur_].size - used_ < size) {
+    ++cur_;
+    used_ = 0;
+  }
+  if (cur_ == blocks_.size()) {
+    const int block_size = std::max(size, block_size_);
+    blocks_.push_back({absl::make_unique<unsigned char[]>(block_size),
+                       block_size});
+    used_ = 0;
+  }
+
+  unsigned char* out = blocks_[cur_].data.get() + used_;
+  used_ += size;
+  return out;
+}
+
+void GFMatArena::Reset() {
+  cur_ = 0;
+  used_ = 0;
+}
+
+GFMat::GFMat(const GF& gf, int h, int w, GFMatArena* arena)
+    : gf_(gf), h_(h), w_(w), arena_(arena) {
+  const int size = w * h;
+  if (size <= kMaxInlineSize) {
+    arr_ = inline_;
+  } else if (arena != nullptr) {
+    arr_ = arena->Allocate(size);
+  } else {
+    heap_ = absl::make_unique<unsigned char[]>(size);
+    arr_ = heap_.get();
+  }
+  std::fill(arr_, arr_ + size, 0);
+}
+
 void GFMat::Load(const std::vector<std::vector<unsigned char>>& in) {
   for (int row = 0; row < in.size(); ++row) {
     for (int col = 0; col < in[row].size(); ++col) {
@@ -35,7 +75,7 @@ std::unique_ptr<GFMat> GFMat::Mult(const GFMat& other) const {
     return nullptr;
   }
 
-  auto out = absl::make_unique<GFMat>(gf(), other.w(), h());
+  auto out = absl::make_unique<GFMat>(gf(), h(), other.w(), arena());
   for (int row = 0; row < h(); ++row) {
     for (int col = 0; col < other.w(); ++col) {
       out->Set(row, col, Dot(row, other, col));
@@ -64,109 +104,131 @@ unsigned char GFSqMat::Determinant() const {
 }
 
 unsigned char GFSqMat::CalculateDeterminant() const {
-  if (sz() == 1) {
-    return Get(0, 0);
-  } else if (sz() == 2) {
-    return gf().Sub(
-        {gf().Mult(Get(0, 0), Get(1, 1)), gf().Mult(Get(1, 0), Get(0, 1))});
+  // Scratch space, so it comes from the heap rather than the arena, which
+  // would hold onto it until the arena is destroyed.
+  GFSqMat lu(gf(), sz());
+  CopyTo(&lu);
+  if (!lu.DecomposeLU(nullptr)) {
+    return 0;
   }
 
-  unsigned char total = 0;
-  GFSqMat sub(gf(), sz() - 1);
+  unsigned char det = 1;
   for (int i = 0; i < sz(); ++i) {
-    unsigned char d = gf().Mult(Get(0, i), SubDeterminant(0, i, &sub));
+    det = gf().Mult(det, lu.Get(i, i));
+  }
+  return det;
+}
 
-    if (i % 2 == 0) {
-      total = gf().Add({total, d});
-    } else {
-      total = gf().Sub({total, d});
+bool GFSqMat::DecomposeLU(std::vector<int>* permutation) {
+  if (permutation != nullptr) {
+    permutation->resize(sz());
+    for (int i = 0; i < sz(); ++i) {
+      (*permutation)[i] = i;
     }
   }
 
-  return total;
-}
-
-unsigned char GFSqMat::SubDeterminant(int exclude_row, int exclude_col,
-                                      GFSqMat* sub) const {
-  int sub_row = 0, sub_col = 0;
-  for (int row = 0; row < sz(); ++row) {
-    if (row == exclude_row) {
-      continue;
+  for (int col = 0; col < sz(); ++col) {
+    // Any non-zero pivot will do. There's no rounding error to minimize.
+    int pivot = col;
+    while (pivot < sz() && Get(pivot, col) == 0) {
+      ++pivot;
+    }
+    if (pivot == sz()) {
+      return false;
+    }
+    if (pivot != col) {
+      SwapRows(pivot, col);
+      if (permutation != nullptr) {
+        std::swap((*permutation)[pivot], (*permutation)[col]);
+      }
     }
 
-    for (int col = 0; col < sz(); ++col) {
-      if (col == exclude_col) {
+    const unsigned char inv_pivot = gf().Inverse(Get(col, col));
+    for (int row = col + 1; row < sz(); ++row) {
+      const unsigned char factor = gf().Mult(Get(row, col), inv_pivot);
+      if (factor == 0) {
         continue;
       }
 
-      sub->Set(sub_row, sub_col, Get(row, col));
-      ++sub_col;
+      // Store the multiplier in L, and eliminate the rest of the row.
+      Set(row, col, factor);
+      for (int i = col + 1; i < sz(); ++i) {
+        Set(row, i, gf().Sub({Get(row, i), gf().Mult(factor, Get(col, i))}));
+      }
     }
-
-    ++sub_row;
-    sub_col = 0;
   }
-
-  return sub->Determinant();
+  return true;
 }
 
 std::unique_ptr<GFSqMat> GFSqMat::Inverse() const {
-  auto out = absl::make_unique<GFSqMat>(gf(), sz());
+  auto out = absl::make_unique<GFSqMat>(gf(), sz(), arena());
+  if (!Inverse(out.get())) {
+    return nullptr;
+  }
+  return out;
+}
 
-  if (sz() == 1) {
-    out->Set(0, 0, gf().Inverse(Get(0, 0)));
-    return out;
+// Gauss-Jordan elimination, reducing [A | I] to [I | A^-1].
+bool GFSqMat::Inverse(GFSqMat* out) const {
+  // Scratch space, as in CalculateDeterminant.
+  GFSqMat a(gf(), sz());
+  CopyTo(&a);
+  for (int i = 0; i < sz(); ++i) {
+    for (int j = 0; j < sz(); ++j) {
+      out->Set(i, j, i == j ? 1 : 0);
+    }
   }
 
-  if (sz() == 2) {
-    out->Set(0, 0, Get(1, 1));
-    out->Set(1, 1, Get(0, 0));
-    out->Set(1, 0, Get(1, 0));
-    out->Set(0, 1, Get(0, 1));
+  for (int col = 0; col < sz(); ++col) {
+    int pivot = col;
+    while (pivot < sz() && a.Get(pivot, col) == 0) {
+      ++pivot;
+    }
+    if (pivot == sz()) {
+      return false;
+    }
+    if (pivot != col) {
+      a.SwapRows(pivot, col);
+      out->SwapRows(pivot, col);
+    }
 
-    unsigned char invdet = gf().Inverse(Determinant());
+    // Scale the pivot row so the pivot is 1.
+    const unsigned char inv_pivot = gf().Inverse(a.Get(col, col));
+    for (int i = 0; i < sz(); ++i) {
+      a.Set(col, i, gf().Mult(inv_pivot, a.Get(col, i)));
+      out->Set(col, i, gf().Mult(inv_pivot, out->Get(col, i)));
+    }
 
-    for (int y = 0; y < out->sz(); ++y) {
-      for (int x = 0; x < out->sz(); ++x) {
-        out->Set(x, y, gf().Mult(invdet, out->Get(x, y)));
+    // Clear the rest of the column, above and below the pivot.
+    for (int row = 0; row < sz(); ++row) {
+      const unsigned char factor = a.Get(row, col);
+      if (row == col || factor == 0) {
+        continue;
+      }
+      for (int i = 0; i < sz(); ++i) {
+        a.Set(row, i, gf().Sub({a.Get(row, i),
+                                gf().Mult(factor, a.Get(col, i))}));
+        out->Set(row, i, gf().Sub({out->Get(row, i),
+                                   gf().Mult(factor, out->Get(col, i))}));
       }
     }
-
-    return out;
   }
 
-  // Invert square matrices larger than 2x2.
-  // Source:
-  // https://www.mathsisfun.com/algebra/matrix-inverse-minors-cofactors-adjugate.html
+  return true;
+}
 
-  // Step 1: Matrix of minors
-  GFSqMat sub(gf(), sz() - 1);
-  for (int row = 0; row < sz(); ++row) {
-    for (int col = 0; col < sz(); ++col) {
-      out->Set(row, col, SubDeterminant(row, col, &sub));
-    }
+void GFSqMat::SwapRows(int a, int b) {
+  for (int i = 0; i < sz(); ++i) {
+    const unsigned char tmp = Get(a, i);
+    Set(a, i, Get(b, i));
+    Set(b, i, tmp);
   }
+}
 
-  // Step 2: Matrix of Cofactors
-  // We can skip this because negation isn't a thing in GF(2^x)
-
-  // Step 3: Transpose
-  // Step 4: Multiply by 1/Determinant
-  unsigned char invdet = gf().Inverse(Determinant());
+void GFSqMat::CopyTo(GFSqMat* out) const {
   for (int row = 0; row < sz(); ++row) {
-    for (int col = 0; col <= row; ++col) {
-      if (row == col) {
-        // On-diagonal, so just multiply
-        out->Set(row, col, gf().Mult(invdet, out->Get(row, col)));
-        continue;
-      }
-
-      // Off-diagonal, so transpose and multiply
-      unsigned char tmp = out->Get(row, col);
-      out->Set(row, col, gf().Mult(invdet, out->Get(col, row)));
-      out->Set(col, row, gf().Mult(invdet, tmp));
+    for (int col = 0; col < sz(); ++col) {
+      out->Set(row, col, Get(row, col));
     }
   }
-
-  return out;
 }
@@ -3,16 +3,56 @@
 #ifndef _QRCODE_GF_MAT_H_
 #define _QRCODE_GF_MAT_H_ 1
 
-#include "qrcode/gf.h"
+#include <memory>
+#include <vector>
 
 #include "absl/types/optional.h"
 
+#include "qrcode/gf.h"
+
+// Provides storage for matrices too large to be stored inline. It hands out
+// pieces of larger blocks, all of which are freed when the arena is
+// destroyed, so the arena must outlive the matrices that use it.
+class GFMatArena {
+ public:
+  explicit GFMatArena(int block_size = 4096) : block_size_(block_size) {}
+
+  GFMatArena(const GFMatArena&) = delete;
+  GFMatArena& operator=(const GFMatArena&) = delete;
+
+  // Returns size bytes of uninitialized storage.
+  unsigned char* Allocate(int size);
+
+  // Makes all storage available for reuse without freeing it. Matrices
+  // allocated from the arena must not be used afterwards.
+  void Reset();
+
+ private:
+  struct Block {
+    std::unique_ptr<unsigned char[]> data;
+    int size;
+  };
+
+  const int block_size_;
+  std::vector<Block> blocks_;
+  int cur_ = 0;   // The block we're allocating from.
+  int used_ = 0;  // The number of bytes used in blocks_[cur_].
+};
+
 class GFMat {
  public:
-  GFMat(const GF& gf, int h, int w)
-      : gf_(gf), h_(h), w_(w), arr_(new unsigned char[w * h]) {}
+  // Matrices with at most this many elements (16x16) are stored inline,
+  // without allocating. Larger ones are stored in arena if one is given, or on
+  // the heap otherwise. Elements are initially zero.
+  static constexpr int kMaxInlineSize = 256;
+
+  GFMat(const GF& gf, int h, int w, GFMatArena* arena = nullptr);
   virtual ~GFMat() = default;
 
+  // arr_ may point into the object itself.
+  GFMat(const GFMat&) = delete;
+  GFMat& operator=(const GFMat&) = delete;
+
   int w() const { return w_; }
   int h() const { return h_; }
 
@@ -30,9 +70,9 @@ class GFMat {
   std::vector<unsigned char> Row(int row);
 
   // Multiply two matrices together as this * other, returning the result in a
-  // new matrix. Note that the result is a GFMat even if the dimensions are such
-  // that it could be a GFSqMat. Returns nullptr if the matrices cannot be
-  // multiplied against each other.
+  // new matrix, which uses this matrix's arena (if any). Note that the result
+  // is a GFMat even if the dimensions are such that it could be a GFSqMat.
+  // Returns nullptr if the matrices cannot be multiplied against each other.
   std::unique_ptr<GFMat> Mult(const GFMat& other) const;
 
   // Dumps the contents of the matrix to cout.
@@ -40,6 +80,7 @@ class GFMat {
 
  protected:
   const GF& gf() const { return gf_; }
+  GFMatArena* arena() const { return arena_; }
 
   virtual void set_dirty() {}
 
@@ -50,34 +91,56 @@ class GFMat {
 
   const GF& gf_;
   const int h_, w_;
+  GFMatArena* const arena_;
+
+  unsigned char inline_[kMaxInlineSize];
+  std::unique_ptr<unsigned char[]> heap_;
   unsigned char* arr_;
 };
 
 // A square matrix
 class GFSqMat : public GFMat {
  public:
-  GFSqMat(const GF& gf, int sz) : GFMat(gf, sz, sz) {}
+  GFSqMat(const GF& gf, int sz, GFMatArena* arena = nullptr)
+      : GFMat(gf, sz, sz, arena) {}
 
   int sz() const { return w(); }
 
-  // Computes the determinant of this matrix.
+  // Computes the determinant of this matrix. Like Inverse, it needs a scratch
+  // copy of the matrix, which for matrices too large to store inline comes
+  // from the heap and not the arena.
   unsigned char Determinant() const;
 
   // Returns the inverse of this matrix. Returns nullptr if the matrix is not
   // invertible.
   std::unique_ptr<GFSqMat> Inverse() const;
 
+  // As above, but stores the inverse in out, which must be the same size as
+  // this matrix. Returns false, leaving out's contents unspecified, if the
+  // matrix is not invertible.
+  bool Inverse(GFSqMat* out) const;
+
+  // Factors this matrix in place as P*A = L*U, where L is lower triangular
+  // with ones on its diagonal and U is upper triangular. U is stored on and
+  // above the diagonal, and L below it. Row i of the result comes from row
+  // (*permutation)[i] of the original matrix. permutation may be null.
+  //
+  // Returns false if the matrix is singular, in which case its contents are
+  // unspecified.
+  bool DecomposeLU(std::vector<int>* permutation);
+
  private:
   // Reset cached values whenever we change the contents of the matrix.
   void set_dirty() { det_.reset(); }
 
+  // Uses LU decomposition, so it's O(n^3). The determinant is the product of
+  // U's diagonal; row swaps would negate it, but -1 = 1 in GF(2^m).
   unsigned char CalculateDeterminant() const;
 
-  // Calculates the determinant of a subset of this matrix. Specifically, the
-  // submatrix formed by excluding the specified row and column. The caller must
-  // specify the submatrix, which must be of size sz()-1.
-  unsigned char SubDeterminant(int exclude_row, int exclude_col,
-                               GFSqMat* sub) const;
+  void SwapRows(int a, int b);
+
+  // Copies the contents of this matrix into out, which must be the same size.
+  void CopyTo(GFSqMat* out) const;
 
   // Mutable because we cache the determinant, which is expensive to calculate.
   mutable absl::optional<unsigned char> det_;
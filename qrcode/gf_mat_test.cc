@@ -5,9 +5,12 @@
 
 namespace {
 
+using ::testing::AnyOf;
+using ::testing::Each;
 using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::IsNull;
+using ::testing::Not;
 
 class GFMatTest : public ::testing::Test {
  public:
@@ -34,6 +37,53 @@ TEST_F(GFMatTest, Row) {
   EXPECT_THAT(mat.Row(1), ElementsAre(30, 0, 0));
 }
 
+TEST_F(GFMatTest, Large) {
+  GFMat mat(gf_, 20, 30);
+  EXPECT_THAT(mat.Row(19), Each(0));
+  mat.Set(19, 29, 7);
+  mat.Set(0, 0, 8);
+  EXPECT_EQ(7, mat.Get(19, 29));
+  EXPECT_EQ(8, mat.Get(0, 0));
+}
+
+TEST_F(GFMatTest, Arena) {
+  GFMatArena arena(1000);
+
+  // Too large to be stored inline, so both come from the arena, and must not
+  // overlap.
+  GFMat a(gf_, 20, 20, &arena);
+  GFMat b(gf_, 20, 20, &arena);
+  for (int i = 0; i < 20; ++i) {
+    a.Set(i, i, 1);
+    b.Set(i, 19 - i, 2);
+  }
+  EXPECT_THAT(a.Row(0), Each(AnyOf(0, 1)));
+  EXPECT_THAT(b.Row(0), Each(AnyOf(0, 2)));
+
+  std::unique_ptr<GFMat> c = a.Mult(b);
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(b.Row(i), c->Row(i)) << i;
+  }
+
+  // Allocations larger than the block size get blocks of their own.
+  GFMat d(gf_, 40, 40, &arena);
+  EXPECT_THAT(d.Row(39), Each(0));
+  d.Set(39, 39, 3);
+  EXPECT_EQ(3, d.Get(39, 39));
+}
+
+TEST(GFMatArenaTest, Reset) {
+  GFMatArena arena(100);
+  unsigned char* first = arena.Allocate(60);
+  unsigned char* second = arena.Allocate(60);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(second + 60, arena.Allocate(40));
+
+  arena.Reset();
+  EXPECT_EQ(first, arena.Allocate(60));
+  EXPECT_EQ(second, arena.Allocate(60));
+}
+
 TEST_F(GFMatTest, Mult_BadDims) {
   EXPECT_THAT(GFMat(gf_, 3, 1).Mult(GFMat(gf_, 2, 3)), IsNull());
 }
@@ -54,6 +104,20 @@ TEST_F(GFMatTest, Mult_1x3_3x1) {
             c->Get(0, 0));
 }
 
+TEST_F(GFMatTest, Mult_2x3_3x4) {
+  GFMat a(gf_, 2, 3);
+  a.Load({{1, 0, 0}, {0, 1, 0}});
+
+  GFMat b(gf_, 3, 4);
+  b.Load({{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}});
+
+  std::unique_ptr<GFMat> c = a.Mult(b);
+  ASSERT_EQ(2, c->h());
+  ASSERT_EQ(4, c->w());
+  EXPECT_THAT(c->Row(0), ElementsAre(1, 2, 3, 4));
+  EXPECT_THAT(c->Row(1), ElementsAre(5, 6, 7, 8));
+}
+
 TEST_F(GFMatTest, Mult_3x1_1x3) {
   GFMat a(gf_, 3, 1);
   a.Load({{0b1001}, {0b1010}, {0b1011}});
@@ -100,7 +164,7 @@ bool IsIdentityMatrix(const GFMat& mat) {
     return false;
   }
 
-  for (int row = 1; row < mat.h(); ++row) {
+  for (int row = 0; row < mat.h(); ++row) {
     for (int col = 0; col < mat.w(); ++col) {
       unsigned char want = 0;
       if (row == col) {
@@ -144,4 +208,125 @@ TEST_F(GFSqMatTest, Inverse3x3) {
   EXPECT_TRUE(IsIdentityMatrix(*res));
 }
 
+TEST_F(GFSqMatTest, Singular) {
+  GFSqMat mat(gf_, 3);
+  mat.Load({{0b0001, 0b0010, 0b0011},
+            {0b0100, 0b0101, 0b0111},
+            {gf_.Mult(0b0110, 0b0001), gf_.Mult(0b0110, 0b0010),
+             gf_.Mult(0b0110, 0b0011)}});
+
+  EXPECT_EQ(0, mat.Determinant());
+  EXPECT_THAT(mat.Inverse(), IsNull());
+
+  std::vector<int> permutation;
+  EXPECT_FALSE(mat.DecomposeLU(&permutation));
+}
+
+// Fills a matrix with arbitrary elements of the field.
+void Fill(const GF& gf, unsigned int* seed, GFSqMat* mat) {
+  for (int row = 0; row < mat->sz(); ++row) {
+    for (int col = 0; col < mat->sz(); ++col) {
+      *seed = *seed * 1103515245 + 12345;
+      mat->Set(row, col, gf.Elements()[(*seed >> 16) % gf.Elements().size()]);
+    }
+  }
+}
+
+// Computes the determinant by cofactor expansion along the first row.
+unsigned char CofactorDeterminant(const GF& gf, const GFSqMat& mat) {
+  if (mat.sz() == 1) {
+    return mat.Get(0, 0);
+  }
+
+  unsigned char det = 0;
+  GFSqMat sub(gf, mat.sz() - 1);
+  for (int exclude = 0; exclude < mat.sz(); ++exclude) {
+    for (int row = 1; row < mat.sz(); ++row) {
+      for (int col = 0, sub_col = 0; col < mat.sz(); ++col) {
+        if (col != exclude) {
+          sub.Set(row - 1, sub_col++, mat.Get(row, col));
+        }
+      }
+    }
+    det = gf.Add(
+        {det, gf.Mult(mat.Get(0, exclude), CofactorDeterminant(gf, sub))});
+  }
+  return det;
+}
+
+TEST_F(GFSqMatTest, DeterminantMatchesCofactors) {
+  unsigned int seed = 1;
+  for (int sz = 1; sz <= 5; ++sz) {
+    for (int i = 0; i < 20; ++i) {
+      GFSqMat mat(gf_, sz);
+      Fill(gf_, &seed, &mat);
+      EXPECT_EQ(CofactorDeterminant(gf_, mat), mat.Determinant())
+          << "sz=" << sz << " i=" << i;
+    }
+  }
+}
+
+TEST_F(GFSqMatTest, DecomposeLU) {
+  GF256 gf;
+  unsigned int seed = 1;
+  GFSqMat mat(gf, 8);
+  Fill(gf, &seed, &mat);
+  mat.Set(0, 0, 0);  // force a row swap
+
+  GFSqMat lu(gf, mat.sz());
+  for (int row = 0; row < mat.sz(); ++row) {
+    for (int col = 0; col < mat.sz(); ++col) {
+      lu.Set(row, col, mat.Get(row, col));
+    }
+  }
+  std::vector<int> permutation;
+  ASSERT_TRUE(lu.DecomposeLU(&permutation));
+  EXPECT_NE(0, permutation[0]);
+
+  GFSqMat l(gf, mat.sz()), u(gf, mat.sz());
+  for (int row = 0; row < mat.sz(); ++row) {
+    for (int col = 0; col < mat.sz(); ++col) {
+      l.Set(row, col, row == col ? 1 : (row > col ? lu.Get(row, col) : 0));
+      u.Set(row, col, row <= col ? lu.Get(row, col) : 0);
+    }
+  }
+
+  std::unique_ptr<GFMat> product = l.Mult(u);
+  for (int row = 0; row < mat.sz(); ++row) {
+    EXPECT_EQ(mat.Row(permutation[row]), product->Row(row)) << row;
+  }
+}
+
+TEST_F(GFSqMatTest, InverseLarge) {
+  GF256 gf;
+  unsigned int seed = 1;
+  for (int sz = 2; sz <= 16; ++sz) {
+    GFSqMat mat(gf, sz);
+    Fill(gf, &seed, &mat);
+
+    std::unique_ptr<GFSqMat> inv = mat.Inverse();
+    if (mat.Determinant() == 0) {
+      EXPECT_THAT(inv, IsNull()) << sz;
+      continue;
+    }
+    ASSERT_THAT(inv, Not(IsNull())) << sz;
+    EXPECT_TRUE(IsIdentityMatrix(*mat.Mult(*inv))) << sz;
+    EXPECT_TRUE(IsIdentityMatrix(*inv->Mult(mat))) << sz;
+    EXPECT_EQ(1, gf.Mult(mat.Determinant(), inv->Determinant())) << sz;
+  }
+}
+
+TEST_F(GFSqMatTest, InverseInPlace) {
+  GF256 gf;
+  GFMatArena arena;
+  unsigned int seed = 1;
+  GFSqMat mat(gf, 20, &arena);
+  Fill(gf, &seed, &mat);
+  ASSERT_NE(0, mat.Determinant());
+
+  GFSqMat inv(gf, 20, &arena);
+  ASSERT_TRUE(mat.Inverse(&inv));
+  EXPECT_TRUE(IsIdentityMatrix(*mat.Mult(inv)));
+}
+
 }  // namespace
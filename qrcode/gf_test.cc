@@ -1,6 +1,9 @@
 #include "qrcode/gf.h"
 
+#include <bitset>
+
 #include "absl/base/macros.h"
+#include "absl/types/span.h"
 #include "gtest/gtest.h"
 
 #include "qrcode/bits.h"
@@ -100,4 +103,153 @@ TEST(GF256Test, Pow) {
   EXPECT_EQ(gf.PowersOfAlpha()[145], gf.Pow(gf.PowersOfAlpha()[200], 2));
 }
 
+TEST(GF256Test, ConstantFolding) {
+  static_assert(GF256::Product(0x80, 0x02) == 0x1d, "x^7 * x wraps");
+  static_assert(GF256::Product(0x53, 0) == 0, "zero annihilates");
+  static_assert(GF256::Product(0x53, GF256::Reciprocal(0x53)) == 1,
+                "x * 1/x = 1");
+  static_assert(GF16::Reciprocal(0b0010) == 0b1001, "1/alpha = alpha^14");
+}
+
+// GF(8), generated by x^3+x+1, isn't used by QR codes but makes sure nothing
+// about the tables is specific to the fields that are.
+using GF8 = GaloisField<3, 0xb>;
+
+TEST(GF8Test, Mult) { TestMult(GF8()); }
+
+TEST(GF8Test, Inverse) { TestInverse(GF8()); }
+
+TEST(GF8Test, Tables) {
+  GF8 gf;
+  EXPECT_EQ(3, gf.m());
+  EXPECT_EQ(std::vector<unsigned char>({1, 2, 4, 3, 6, 7, 5}),
+            gf.PowersOfAlpha());
+  EXPECT_EQ(std::vector<unsigned char>({1, 2, 4, 3, 6, 7, 5, 0}),
+            gf.Elements());
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_EQ(i, gf.ToAlphaPow(gf.AlphaPow(i)));
+  }
+}
+
+TEST(FastGF256Test, MatchesGF256) {
+  GF256 gf;
+  FastGF256 fast;
+
+  EXPECT_EQ(gf.m(), fast.m());
+  for (int i = 0; i < 256; ++i) {
+    for (int j = 0; j < 256; ++j) {
+      ASSERT_EQ(gf.Mult(i, j), fast.Mult(i, j)) << i << "*" << j;
+    }
+    const unsigned char elem = i;
+    EXPECT_EQ(gf.Add({elem, 0x5a}), fast.Add({elem, 0x5a}));
+    EXPECT_EQ(gf.Pow(i, 0), fast.Pow(i, 0)) << i;
+    EXPECT_EQ(gf.Pow(i, 7), fast.Pow(i, 7)) << i;
+    EXPECT_EQ(gf.ToAlphaPow(i), fast.ToAlphaPow(i)) << i;
+    EXPECT_EQ(gf.Inverse(i), fast.Inverse(i)) << i;
+  }
+  for (int i = 0; i < 600; ++i) {
+    EXPECT_EQ(gf.AlphaPow(i), fast.AlphaPow(i)) << i;
+  }
+}
+
+// Lengths either side of the 32-element vector width.
+constexpr int kBulkSizes[] = {0, 1, 31, 32, 33, 64, 70, 255};
+
+std::vector<unsigned char> RandomElements(int n, unsigned int* seed) {
+  std::vector<unsigned char> out(n);
+  for (auto& elem : out) {
+    *seed = *seed * 1103515245 + 12345;
+    elem = *seed >> 16;
+  }
+  return out;
+}
+
+// The bulk operations are tested with and without vector instructions. On
+// CPUs without AVX2, both use the scalar versions.
+constexpr bool kUseSimd[] = {false, true};
+
+TEST(FastGF256Test, MultAdd) {
+  for (const bool use_simd : kUseSimd) {
+    FastGF256 gf(use_simd);
+    unsigned int seed = 1;
+    for (const int n : kBulkSizes) {
+      for (const int c : {0, 1, 2, 0x53, 0xff}) {
+        const std::vector<unsigned char> src = RandomElements(n, &seed);
+        std::vector<unsigned char> dst = RandomElements(n, &seed);
+        std::vector<unsigned char> want = dst;
+        for (int i = 0; i < n; ++i) {
+          want[i] ^= gf.Mult(c, src[i]);
+        }
+
+        gf.MultAdd(c, src, absl::MakeSpan(dst));
+        EXPECT_EQ(want, dst)
+            << "n=" << n << " c=" << c << " simd=" << gf.simd();
+      }
+    }
+  }
+}
+
+TEST(FastGF256Test, EvalPoly) {
+  for (const bool use_simd : kUseSimd) {
+    FastGF256 gf(use_simd);
+    unsigned int seed = 1;
+    for (const int n : kBulkSizes) {
+      const std::vector<unsigned char> poly = RandomElements(n, &seed);
+      std::vector<unsigned char> points = RandomElements(10, &seed);
+      points[0] = 0;
+      points[1] = 1;
+
+      std::vector<unsigned char> out(points.size());
+      gf.EvalPoly(poly, points, absl::MakeSpan(out));
+      for (int j = 0; j < points.size(); ++j) {
+        unsigned char want = 0;
+        for (int i = 0; i < n; ++i) {
+          want ^= gf.Mult(poly[i], gf.Pow(points[j], n - 1 - i));
+        }
+        EXPECT_EQ(want, out[j]) << "n=" << n << " point " << int(points[j])
+                                << " simd=" << gf.simd();
+      }
+    }
+  }
+}
+
+TEST(FastGF256Test, DotProduct) {
+  for (const bool use_simd : kUseSimd) {
+    FastGF256 gf(use_simd);
+    unsigned int seed = 1;
+    for (const int n : kBulkSizes) {
+      const std::vector<unsigned char> a = RandomElements(n, &seed);
+      const std::vector<unsigned char> b = RandomElements(n, &seed);
+      unsigned char want = 0;
+      for (int i = 0; i < n; ++i) {
+        want ^= gf.Mult(a[i], b[i]);
+      }
+      EXPECT_EQ(want, gf.DotProduct(a, b))
+          << "n=" << n << " simd=" << gf.simd();
+    }
+
+    // Every pair of elements, 256 at a time.
+    std::vector<unsigned char> all(256);
+    for (int i = 0; i < 256; ++i) {
+      all[i] = i;
+    }
+    for (int c = 0; c < 256; ++c) {
+      const std::vector<unsigned char> b(256, c);
+      unsigned char want = 0;
+      for (int i = 0; i < 256; ++i) {
+        want ^= gf.Mult(i, c);
+      }
+      ASSERT_EQ(want, gf.DotProduct(all, b)) << c << " simd=" << gf.simd();
+    }
+  }
+}
+
+// Flags hosts where the tests above only covered the scalar versions.
+TEST(FastGF256Test, Simd) {
+  EXPECT_FALSE(FastGF256(false).simd());
+  if (!FastGF256().simd()) {
+    GTEST_SKIP() << "no AVX2 on this CPU";
+  }
+}
+
 }  // namespace
@@ -0,0 +1,80 @@
+#include "qrcode/homography.h"
+
+#include <cmath>
+
+namespace {
+
+// Quads are degenerate when this is the best they can do.
+constexpr double kEpsilon = 1e-9;
+
+}  // namespace
+
+absl::optional<Homography::Matrix> Homography::SquareToQuad(const Quad& quad) {
+  const double x0 = quad[0].x, y0 = quad[0].y;
+  const double x1 = quad[1].x, y1 = quad[1].y;
+  const double x2 = quad[2].x, y2 = quad[2].y;
+  const double x3 = quad[3].x, y3 = quad[3].y;
+
+  // How far quad is from being a parallelogram. If it is one, the transform
+  // is affine.
+  const double dx3 = x0 - x1 + x2 - x3;
+  const double dy3 = y0 - y1 + y2 - y3;
+
+  double g = 0, h = 0;
+  if (std::abs(dx3) > kEpsilon || std::abs(dy3) > kEpsilon) {
+    const double dx1 = x1 - x2, dx2 = x3 - x2;
+    const double dy1 = y1 - y2, dy2 = y3 - y2;
+    const double den = dx1 * dy2 - dx2 * dy1;
+    if (std::abs(den) < kEpsilon) {
+      return absl::nullopt;
+    }
+    g = (dx3 * dy2 - dx2 * dy3) / den;
+    h = (dx1 * dy3 - dx3 * dy1) / den;
+  }
+
+  const Matrix m = {x1 - x0 + g * x1, x3 - x0 + h * x3, x0,  //
+                    y1 - y0 + g * y1, y3 - y0 + h * y3, y0,  //
+                    g,                h,                1};
+  const double det = m[0] * (m[4] * m[8] - m[5] * m[7]) -
+                     m[1] * (m[3] * m[8] - m[5] * m[6]) +
+                     m[2] * (m[3] * m[7] - m[4] * m[6]);
+  if (std::abs(det) < kEpsilon) {
+    return absl::nullopt;
+  }
+  return m;
+}
+
+absl::optional<Homography> Homography::FromQuads(const Quad& from,
+                                                 const Quad& to) {
+  const absl::optional<Matrix> maybe_s = SquareToQuad(from);
+  const absl::optional<Matrix> maybe_t = SquareToQuad(to);
+  if (!maybe_s.has_value() || !maybe_t.has_value()) {
+    return absl::nullopt;
+  }
+  const Matrix& s = *maybe_s;
+  const Matrix& t = *maybe_t;
+
+  // Homographies are only defined up to scale, so the adjugate does as well
+  // as the inverse.
+  const Matrix s_inv = {
+      s[4] * s[8] - s[5] * s[7], s[2] * s[7] - s[1] * s[8],
+      s[1] * s[5] - s[2] * s[4], s[5] * s[6] - s[3] * s[8],
+      s[0] * s[8] - s[2] * s[6], s[2] * s[3] - s[0] * s[5],
+      s[3] * s[7] - s[4] * s[6], s[1] * s[6] - s[0] * s[7],
+      s[0] * s[4] - s[1] * s[3],
+  };
+
+  Matrix m;
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) {
+      m[r * 3 + c] = t[r * 3] * s_inv[c] + t[r * 3 + 1] * s_inv[3 + c] +
+                     t[r * 3 + 2] * s_inv[6 + c];
+    }
+  }
+  return Homography(m);
+}
+
+Point Homography::MapToPixel(double x, double y) const {
+  const Coord coord = Map(x, y);
+  return Point(std::lround(coord.x), std::lround(coord.y));
+}
@@ -0,0 +1,48 @@
+#ifndef _QRCODE_HOMOGRAPHY_H_
+#define _QRCODE_HOMOGRAPHY_H_ 1
+
+#include <array>
+
+#include "absl/types/optional.h"
+
+#include "qrcode/point.h"
+
+// A projective transform of the plane, which maps any quadrilateral onto any
+// other. This is what a camera does to a flat code that isn't square to it.
+class Homography {
+ public:
+  struct Coord {
+    double x, y;
+  };
+  using Quad = std::array<Coord, 4>;
+
+  // Returns the homography that maps each corner of from onto the
+  // corresponding corner of to. Both quads must list their corners in the
+  // same order around the edge. Returns nullopt if either quad is degenerate
+  // (three of its corners are collinear).
+  static absl::optional<Homography> FromQuads(const Quad& from,
+                                              const Quad& to);
+
+  Coord Map(double x, double y) const {
+    const double w = m_[6] * x + m_[7] * y + m_[8];
+    return {(m_[0] * x + m_[1] * y + m_[2]) / w,
+            (m_[3] * x + m_[4] * y + m_[5]) / w};
+  }
+
+  // Returns the pixel nearest to where {x, y} maps.
+  Point MapToPixel(double x, double y) const;
+
+ private:
+  // The transform as a row-major 3x3 matrix.
+  using Matrix = std::array<double, 9>;
+
+  explicit Homography(const Matrix& m) : m_(m) {}
+
+  // Returns the homography that maps the unit square, from {0, 0} clockwise,
+  // onto quad.
+  static absl::optional<Matrix> SquareToQuad(const Quad& quad);
+
+  Matrix m_;
+};
+
+#endif  // _QRCODE_HOMOGRAPHY_H_
@@ -0,0 +1,64 @@
+#include "qrcode/homography.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using ::testing::DoubleNear;
+using ::testing::Eq;
+
+MATCHER_P2(CoordNear, x, y, "") {
+  return std::abs(arg.x - x) < 1e-6 && std::abs(arg.y - y) < 1e-6;
+}
+
+constexpr Homography::Quad kUnitSquare = {{{0, 0}, {1, 0}, {1, 1}, {0, 1}}};
+
+TEST(HomographyTest, Corners) {
+  const Homography::Quad to = {{{10, 20}, {110, 30}, {90, 140}, {5, 100}}};
+
+  absl::optional<Homography> h = Homography::FromQuads(kUnitSquare, to);
+  ASSERT_TRUE(h.has_value());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_THAT(h->Map(kUnitSquare[i].x, kUnitSquare[i].y),
+                CoordNear(to[i].x, to[i].y))
+        << i;
+  }
+}
+
+TEST(HomographyTest, QuadToQuad) {
+  const Homography::Quad from = {{{3.5, 3.5}, {21.5, 3.5}, {18.5, 18.5},
+                                  {3.5, 21.5}}};
+  const Homography::Quad to = {{{100, 100}, {300, 120}, {260, 280},
+                                {90, 310}}};
+
+  absl::optional<Homography> h = Homography::FromQuads(from, to);
+  ASSERT_TRUE(h.has_value());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_THAT(h->Map(from[i].x, from[i].y), CoordNear(to[i].x, to[i].y))
+        << i;
+  }
+
+  // Straight lines stay straight: the midpoint of an edge lands on the
+  // corresponding edge.
+  const Homography::Coord mid = h->Map(12.5, 3.5);
+  EXPECT_THAT((mid.y - 100) / (mid.x - 100), DoubleNear(20.0 / 200, 1e-9));
+}
+
+TEST(HomographyTest, Affine) {
+  // A parallelogram, so the mapping is affine and midpoints are preserved.
+  const Homography::Quad to = {{{0, 0}, {100, 50}, {150, 150}, {50, 100}}};
+
+  absl::optional<Homography> h = Homography::FromQuads(kUnitSquare, to);
+  ASSERT_TRUE(h.has_value());
+  EXPECT_THAT(h->Map(0.5, 0.5), CoordNear(75, 75));
+  EXPECT_THAT(h->MapToPixel(0.5, 0), Eq(Point(50, 25)));
+}
+
+TEST(HomographyTest, Degenerate) {
+  const Homography::Quad collinear = {{{0, 0}, {1, 1}, {2, 2}, {0, 5}}};
+  EXPECT_FALSE(Homography::FromQuads(kUnitSquare, collinear).has_value());
+  EXPECT_FALSE(Homography::FromQuads(collinear, kUnitSquare).has_value());
+}
+
+}  // namespace
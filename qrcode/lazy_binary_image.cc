@@ -0,0 +1,70 @@
+#include "qrcode/lazy_binary_image.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "qrcode/row_runs.h"
+
+constexpr int LazyBinaryImage::kTileWidth;
+
+LazyBinaryImage::LazyBinaryImage(const cv::Mat& gray, int threshold)
+    : gray_(gray),
+      threshold_(threshold),
+      tiles_per_row_((gray.cols + kTileWidth - 1) / kTileWidth),
+      num_tiles_(tiles_per_row_ * gray.rows),
+      cache_(gray.rows, gray.cols, CV_8UC1),
+      tiles_(new std::atomic<TileState>[num_tiles_]) {
+  for (int i = 0; i < num_tiles_; ++i) {
+    tiles_[i].store(kPending, std::memory_order_relaxed);
+  }
+}
+
+void LazyBinaryImage::BinarizeTile(int tile) const {
+  TileState state = kPending;
+  if (!tiles_[tile].compare_exchange_strong(state, kBusy,
+                                            std::memory_order_acquire)) {
+    // Another thread got here first. Wait for it to finish.
+    while (tiles_[tile].load(std::memory_order_acquire) != kDone) {
+      std::this_thread::yield();
+    }
+    return;
+  }
+
+  const int y = tile / tiles_per_row_;
+  const int x0 = (tile % tiles_per_row_) * kTileWidth;
+  const int x1 = std::min(x0 + kTileWidth, gray_.cols);
+  const unsigned char* in = gray_.ptr<unsigned char>(y);
+  unsigned char* out = cache_.ptr<unsigned char>(y);
+  for (int x = x0; x < x1; ++x) {
+    out[x] = in[x] > threshold_ ? 255 : 0;
+  }
+
+  tiles_[tile].store(kDone, std::memory_order_release);
+}
+
+int LazyBinaryImage::RowRunLength(int x, int y) const {
+  const unsigned char* row = cache_.ptr<unsigned char>(y);
+  const bool want = Get(x, y) != 0;
+
+  // Runs are found a tile at a time, since only the current tile is known to
+  // be thresholded.
+  int pos = x;
+  for (;;) {
+    const int tile_end =
+        std::min(gray_.cols, (pos / kTileWidth + 1) * kTileWidth);
+    pos += ::RowRunLength(row + pos, tile_end - pos);
+    if (pos < tile_end || pos == gray_.cols || (Get(pos, y) != 0) != want) {
+      return pos - x;
+    }
+  }
+}
+
+int LazyBinaryImage::NumTilesBinarized() const {
+  int num_done = 0;
+  for (int i = 0; i < num_tiles_; ++i) {
+    if (tiles_[i].load(std::memory_order_acquire) == kDone) {
+      ++num_done;
+    }
+  }
+  return num_done;
+}
@@ -0,0 +1,117 @@
+#ifndef _QRCODE_LAZY_BINARY_IMAGE_H_
+#define _QRCODE_LAZY_BINARY_IMAGE_H_ 1
+
+#include <atomic>
+#include <memory>
+
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/pixel_iterator.h"
+#include "qrcode/point.h"
+
+// A black-and-white view of a grayscale image that only thresholds the parts
+// that are read.
+//
+// Each row is divided into tiles kTileWidth pixels wide. The first read of a
+// pixel thresholds its whole tile into a cache, where later reads find it.
+// Tiles are a single row tall so that rows the locator skips (see
+// LocateOptions::row_step) are never thresholded, and a column walk only
+// thresholds a short stretch of each row it crosses. Pixels greater than the
+// threshold are white (255) and the rest are black (0), as with
+// GlobalBinarizer. Reads may come from several threads at once.
+class LazyBinaryImage {
+ public:
+  static constexpr int kTileWidth = 64;
+
+  // Does not take ownership of gray, which must outlive this object and must
+  // not change while it's in use.
+  LazyBinaryImage(const cv::Mat& gray, int threshold);
+  ~LazyBinaryImage() = default;
+
+  LazyBinaryImage(const LazyBinaryImage&) = delete;
+
+  int width() const { return gray_.cols; }
+  int height() const { return gray_.rows; }
+
+  unsigned char Get(int x, int y) const {
+    EnsureTile(x, y);
+    return cache_.ptr<unsigned char>(y)[x];
+  }
+
+  // Returns the length of the run that starts at {x, y} and continues to the
+  // right, stopping at the end of the row. Only the tiles the run crosses, and
+  // the one that ends it, are thresholded.
+  int RowRunLength(int x, int y) const;
+
+  // Returns the number of tiles thresholded so far, and in total.
+  int NumTilesBinarized() const;
+  int num_tiles() const { return num_tiles_; }
+
+ private:
+  enum TileState : unsigned char { kPending, kBusy, kDone };
+
+  void EnsureTile(int x, int y) const {
+    const int tile = y * tiles_per_row_ + x / kTileWidth;
+    if (tiles_[tile].load(std::memory_order_acquire) != kDone) {
+      BinarizeTile(tile);
+    }
+  }
+
+  void BinarizeTile(int tile) const;
+
+  const cv::Mat gray_;
+  const int threshold_;
+  const int tiles_per_row_;
+  const int num_tiles_;
+
+  // Allocated up front but only written a tile at a time, so untouched parts
+  // of it never need to be paged in.
+  mutable cv::Mat cache_;
+  std::unique_ptr<std::atomic<TileState>[]> tiles_;
+};
+
+// A PixelIterator for LazyBinaryImages.
+class LazyPixelIterator {
+ public:
+  explicit LazyPixelIterator(const LazyBinaryImage* image)
+      : x_(0), y_(0), image_(image) {}
+  ~LazyPixelIterator() = default;
+
+  bool Seek(int x, int y) {
+    if (y < 0 || y >= image_->height() || x < 0 || x >= image_->width()) {
+      return false;
+    }
+
+    x_ = x;
+    y_ = y;
+    return true;
+  }
+
+  bool RelSeek(int delta_x, int delta_y) {
+    return Seek(x_ + delta_x, y_ + delta_y);
+  }
+
+  bool Seek(Point p) { return Seek(p.x, p.y); }
+
+  unsigned char Get() { return image_->Get(x_, y_); }
+
+  // See PixelIterator::ForwardRowRunLength.
+  int ForwardRowRunLength(int* remaining) {
+    *remaining = image_->width() - x_;
+    return image_->RowRunLength(x_, y_);
+  }
+
+  using Directional =
+      DirectionalIterator<const unsigned char, LazyPixelIterator>;
+
+  Directional MakeForwardRowIterator() { return Directional(*this, 1, 0); }
+  Directional MakeReverseRowIterator() { return Directional(*this, -1, 0); }
+  Directional MakeForwardColumnIterator() { return Directional(*this, 0, 1); }
+  Directional MakeReverseColumnIterator() { return Directional(*this, 0, -1); }
+
+ private:
+  int x_, y_;
+  const LazyBinaryImage* image_;
+};
+
+#endif  // _QRCODE_LAZY_BINARY_IMAGE_H_
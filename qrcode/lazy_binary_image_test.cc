@@ -0,0 +1,145 @@
+#include "qrcode/lazy_binary_image.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "qrcode/pixel_iterator.h"
+#include "qrcode/runner.h"
+
+namespace {
+
+constexpr int kTile = LazyBinaryImage::kTileWidth;
+
+// Returns a gray image of random runs of light and dark pixels, along with the
+// thresholded version.
+void MakeImages(int width, int height, cv::Mat* gray, cv::Mat* bw) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> len_dist(1, 2 * kTile);
+  std::uniform_int_distribution<int> light_dist(128, 255);
+  std::uniform_int_distribution<int> dark_dist(0, 127);
+
+  *gray = cv::Mat(height, width, CV_8UC1);
+  *bw = cv::Mat(height, width, CV_8UC1);
+  bool light = false;
+  int left = 0;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      if (left-- == 0) {
+        light = !light;
+        left = len_dist(gen);
+      }
+      gray->at<unsigned char>(y, x) = light ? light_dist(gen) : dark_dist(gen);
+      bw->at<unsigned char>(y, x) = light ? 255 : 0;
+    }
+  }
+}
+
+TEST(LazyBinaryImageTest, Get) {
+  cv::Mat gray, bw;
+  MakeImages(3 * kTile + 5, 40, &gray, &bw);
+  LazyBinaryImage image(gray, 127);
+  EXPECT_EQ(0, image.NumTilesBinarized());
+
+  // Reading one pixel thresholds only its tile.
+  EXPECT_EQ(bw.at<unsigned char>(21, 2 * kTile + 1),
+            image.Get(2 * kTile + 1, 21));
+  EXPECT_EQ(1, image.NumTilesBinarized());
+
+  for (int y = 0; y < gray.rows; ++y) {
+    for (int x = 0; x < gray.cols; ++x) {
+      ASSERT_EQ(bw.at<unsigned char>(y, x), image.Get(x, y))
+          << "x " << x << " y " << y;
+    }
+  }
+  EXPECT_EQ(4 * gray.rows, image.NumTilesBinarized());
+  EXPECT_EQ(image.num_tiles(), image.NumTilesBinarized());
+}
+
+// Rows that aren't read are never thresholded.
+TEST(LazyBinaryImageTest, SkippedRows) {
+  cv::Mat gray, bw;
+  MakeImages(3 * kTile, 30, &gray, &bw);
+  LazyBinaryImage image(gray, 127);
+
+  for (int y = 0; y < gray.rows; y += 3) {
+    LazyPixelIterator iter(&image);
+    int remaining;
+    for (int x = 0; x < gray.cols; x += iter.ForwardRowRunLength(&remaining)) {
+      ASSERT_TRUE(iter.Seek(x, y));
+    }
+  }
+  EXPECT_EQ(3 * 10, image.NumTilesBinarized());
+}
+
+// Runners over the lazy view must see the same runs as over the thresholded
+// image, in every direction, and the row fast path must cope with runs that
+// span tiles.
+TEST(LazyBinaryImageTest, MatchesPixelIterator) {
+  cv::Mat gray, bw;
+  MakeImages(5 * kTile + 7, 50, &gray, &bw);
+  LazyBinaryImage image(gray, 127);
+
+  PixelIterator<const unsigned char> bw_iter = PixelIteratorFromGrayImage(bw);
+  LazyPixelIterator lazy_iter(&image);
+
+  auto all_runs = [](auto iter) {
+    FixedRunner<1, decltype(iter)> runner(iter);
+    std::vector<int> runs;
+    for (;;) {
+      auto run = runner.Next(1, nullptr);
+      if (!run.has_value()) {
+        return runs;
+      }
+      runs.push_back((*run)[0]);
+    }
+  };
+
+  for (int y = 0; y < gray.rows; y += 7) {
+    for (int x : {0, kTile - 1, kTile, 3 * kTile + 2}) {
+      ASSERT_TRUE(bw_iter.Seek(x, y));
+      ASSERT_TRUE(lazy_iter.Seek(x, y));
+
+      EXPECT_EQ(all_runs(bw_iter.MakeForwardColumnIterator()),
+                all_runs(lazy_iter.MakeForwardColumnIterator()));
+      EXPECT_EQ(all_runs(bw_iter.MakeReverseColumnIterator()),
+                all_runs(lazy_iter.MakeReverseColumnIterator()));
+      EXPECT_EQ(all_runs(bw_iter.MakeForwardRowIterator()),
+                all_runs(lazy_iter.MakeForwardRowIterator()));
+      EXPECT_EQ(all_runs(bw_iter.MakeReverseRowIterator()),
+                all_runs(lazy_iter.MakeReverseRowIterator()));
+    }
+  }
+}
+
+TEST(LazyBinaryImageTest, Threaded) {
+  cv::Mat gray, bw;
+  MakeImages(8 * kTile, 64, &gray, &bw);
+  LazyBinaryImage image(gray, 127);
+
+  // Every thread reads every pixel, so they contend for every tile.
+  std::vector<int> mismatches(4);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < mismatches.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      for (int y = 0; y < gray.rows; ++y) {
+        for (int x = 0; x < gray.cols; ++x) {
+          if (image.Get(x, y) != bw.at<unsigned char>(y, x)) {
+            ++mismatches[i];
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (int count : mismatches) {
+    EXPECT_EQ(0, count);
+  }
+}
+
+}  // namespace
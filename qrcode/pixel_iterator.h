@@ -2,6 +2,7 @@
 #define _QRCODE_PIXEL_ITERATOR_ 1
 
 #include "qrcode/qr_types.h"
+#include "qrcode/row_runs.h"
 
 namespace cv {
 class Mat;
@@ -10,10 +11,14 @@ class Mat;
 template <class T>
 class PixelIterator;
 
-template <class T>
+// Walks an image in one direction from a starting point. Iter is the
+// underlying pixel iterator, which is usually a PixelIterator, but may be
+// anything providing RelSeek, Get, and ForwardRowRunLength (see
+// BitPixelIterator).
+template <class T, class Iter = PixelIterator<T>>
 class DirectionalIterator {
  public:
-  DirectionalIterator(PixelIterator<T> iter, int row_delta, int col_delta)
+  DirectionalIterator(Iter iter, int row_delta, int col_delta)
       : iter_(iter), row_delta_(row_delta), col_delta_(col_delta) {}
   virtual ~DirectionalIterator() = default;
 
@@ -21,8 +26,24 @@ class DirectionalIterator {
 
   T Get() { return iter_.Get(); }
 
+  // Moves n steps at once. Returns false, without moving, if that would leave
+  // the image.
+  bool Advance(int n) { return iter_.RelSeek(col_delta_ * n, row_delta_ * n); }
+
+  // If this iterator walks forward along a row, the underlying iterator can
+  // find runs faster than one pixel at a time. In that case, returns the
+  // length of the run that starts at the current pixel, and sets *remaining to
+  // the number of pixels from it to the end of the row, inclusive. Returns 0
+  // otherwise.
+  int ForwardRowRunLength(int* remaining) {
+    if (col_delta_ != 1 || row_delta_ != 0) {
+      return 0;
+    }
+    return iter_.ForwardRowRunLength(remaining);
+  }
+
  private:
-  PixelIterator<T> iter_;
+  Iter iter_;
   int row_delta_, col_delta_;
 };
 
@@ -56,6 +77,14 @@ class PixelIterator {
 
   T Get() { return data_[cur_]; }
 
+  // Returns the length of the run that starts at the current pixel and
+  // continues to the right, and sets *remaining to the number of pixels from
+  // the current one to the end of its row, inclusive.
+  int ForwardRowRunLength(int* remaining) {
+    *remaining = width_ - x_;
+    return RowRunLength(&data_[cur_], *remaining);
+  }
+
   DirectionalIterator<T> MakeForwardRowIterator() {
     return DirectionalIterator<T>(*this, 1, 0);
   }
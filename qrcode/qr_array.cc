@@ -1,7 +1,12 @@
 #include "qrcode/qr_array.h"
 
+constexpr unsigned char QRCodeArray::kCertain;
+
 QRCodeArray::QRCodeArray(int height, int width)
-    : height_(height), width_(width), array_(height * width) {}
+    : height_(height),
+      width_(width),
+      array_(height * width),
+      confidence_(height * width, kCertain) {}
 
 void QRCodeArray::Set(Point p, bool val) {
   if (p.x < 0 || p.y < 0 || p.x >= width_ || p.y >= height_) {
@@ -19,6 +24,29 @@ bool QRCodeArray::Get(Point p) const {
   return array_[p.y * width_ + p.x];
 }
 
+void QRCodeArray::SetConfidence(Point p, unsigned char confidence) {
+  if (p.x < 0 || p.y < 0 || p.x >= width_ || p.y >= height_) {
+    return;
+  }
+
+  confidence_[p.y * width_ + p.x] = confidence;
+}
+
+unsigned char QRCodeArray::GetConfidence(Point p) const {
+  if (p.x < 0 || p.y < 0 || p.x >= width_ || p.y >= height_) {
+    return 0;
+  }
+
+  return confidence_[p.y * width_ + p.x];
+}
+
+unsigned char QRCodeArray::ConfidenceFromSamples(int agreeing, int total) {
+  if (total <= 0 || 2 * agreeing <= total) {
+    return 0;
+  }
+  return (2 * agreeing - total) * kCertain / total;
+}
+
 void QRCodeArray::Dump() const {
   int num_rows = 0;
   int div = 1;
@@ -17,11 +17,23 @@ class QRCodeArray {
   void Set(Point p, bool val);
   bool Get(Point p) const;
 
+  // How sure the extractor was of a module's value, from 0 (no better than a
+  // guess) to kCertain. Modules are certain until told otherwise.
+  static constexpr unsigned char kCertain = 255;
+  void SetConfidence(Point p, unsigned char confidence);
+  unsigned char GetConfidence(Point p) const;
+
+  // Returns the confidence in a module's value when agreeing of the total
+  // pixels sampled from it agree with that value: kCertain if they all do,
+  // and 0 if half or fewer do.
+  static unsigned char ConfidenceFromSamples(int agreeing, int total);
+
   void Dump() const;
 
  private:
   int height_, width_;
   std::vector<bool> array_;
+  std::vector<unsigned char> confidence_;
 };
 
 #endif  // _QRCODE_QR_ARRAY_H_
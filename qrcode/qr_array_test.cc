@@ -11,4 +11,23 @@ TEST(QRCodeArrayTest, Test) {
   EXPECT_FALSE(arr.Get(Point(1, 0)));
 }
 
+TEST(QRCodeArrayTest, Confidence) {
+  QRCodeArray arr(3, 5);
+  EXPECT_EQ(QRCodeArray::kCertain, arr.GetConfidence(Point(4, 2)));
+
+  arr.SetConfidence(Point(4, 2), 10);
+  arr.Set(Point(4, 2), true);
+  EXPECT_EQ(10, arr.GetConfidence(Point(4, 2)));
+  EXPECT_EQ(QRCodeArray::kCertain, arr.GetConfidence(Point(3, 2)));
+  EXPECT_EQ(0, arr.GetConfidence(Point(5, 2)));
+}
+
+TEST(QRCodeArrayTest, ConfidenceFromSamples) {
+  EXPECT_EQ(QRCodeArray::kCertain, QRCodeArray::ConfidenceFromSamples(9, 9));
+  EXPECT_EQ(141, QRCodeArray::ConfidenceFromSamples(7, 9));
+  EXPECT_EQ(0, QRCodeArray::ConfidenceFromSamples(2, 4));
+  EXPECT_EQ(0, QRCodeArray::ConfidenceFromSamples(1, 9));
+  EXPECT_EQ(0, QRCodeArray::ConfidenceFromSamples(0, 0));
+}
+
 }  // namespace
@@ -5,16 +5,51 @@
 
 namespace {
 
-constexpr int kModulesPerSide[] = {-1, 21, 25, 29, 33, 37, 41};
-
-constexpr int kAlignmentCenters[][6] = {
-    {},       // v0
-    {},       // v1
-    {6, 18},  // v2
-    {6, 22},  // v3
-    {6, 26},  // v4
-    {6, 30},  // v5
-    {6, 34},  // v6
+constexpr int kMaxVersion = 40;
+
+// From ISO/IEC 18004:2015 Annex E.
+constexpr int kAlignmentCenters[][7] = {
+    {},                              // v0
+    {},                              // v1
+    {6, 18},                         // v2
+    {6, 22},                         // v3
+    {6, 26},                         // v4
+    {6, 30},                         // v5
+    {6, 34},                         // v6
+    {6, 22, 38},                     // v7
+    {6, 24, 42},                     // v8
+    {6, 26, 46},                     // v9
+    {6, 28, 50},                     // v10
+    {6, 30, 54},                     // v11
+    {6, 32, 58},                     // v12
+    {6, 34, 62},                     // v13
+    {6, 26, 46, 66},                 // v14
+    {6, 26, 48, 70},                 // v15
+    {6, 26, 50, 74},                 // v16
+    {6, 30, 54, 78},                 // v17
+    {6, 30, 56, 82},                 // v18
+    {6, 30, 58, 86},                 // v19
+    {6, 34, 62, 90},                 // v20
+    {6, 28, 50, 72, 94},             // v21
+    {6, 26, 50, 74, 98},             // v22
+    {6, 30, 54, 78, 102},            // v23
+    {6, 28, 54, 80, 106},            // v24
+    {6, 32, 58, 84, 110},            // v25
+    {6, 30, 58, 86, 114},            // v26
+    {6, 34, 62, 90, 118},            // v27
+    {6, 26, 50, 74, 98, 122},        // v28
+    {6, 30, 54, 78, 102, 126},       // v29
+    {6, 26, 52, 78, 104, 130},       // v30
+    {6, 30, 56, 82, 108, 134},       // v31
+    {6, 34, 60, 86, 112, 138},       // v32
+    {6, 30, 58, 86, 114, 142},       // v33
+    {6, 34, 62, 90, 118, 146},       // v34
+    {6, 30, 54, 78, 102, 126, 150},  // v35
+    {6, 24, 50, 76, 102, 128, 154},  // v36
+    {6, 28, 54, 80, 106, 132, 158},  // v37
+    {6, 32, 58, 84, 110, 136, 162},  // v38
+    {6, 26, 54, 82, 110, 138, 166},  // v39
+    {6, 30, 58, 86, 114, 142, 170},  // v40
 };
 
 void WriteBlock(const Point& top_left, const Point& bottom_right,
@@ -63,9 +98,15 @@ MakeTypeMap(const int version, const int modules_per_side) {
              modules_per_side, QRAttributes::TYPE_FORMAT_INFORMATION,
              type_map.get());
 
-  // Version
+  // Version, in two 6x3 blocks: one above the bottom left positioning block,
+  // and its transpose to the left of the top right one.
   if (version >= 7) {
-    return "versions containing version block not supported";
+    WriteBlock(Point(0, modules_per_side - 11), Point(5, modules_per_side - 9),
+               modules_per_side, QRAttributes::TYPE_VERSION_INFORMATION,
+               type_map.get());
+    WriteBlock(Point(modules_per_side - 11, 0), Point(modules_per_side - 9, 5),
+               modules_per_side, QRAttributes::TYPE_VERSION_INFORMATION,
+               type_map.get());
   }
 
   // Timing
@@ -76,21 +117,15 @@ MakeTypeMap(const int version, const int modules_per_side) {
 
   // Alignment
   //
-  // Any combination of the values that aren't currently occupied by
-  // other things (mainly position detection patterns).
-  for (const int& c1 : kAlignmentCenters[version]) {
-    if (c1 == 0) {
-      break;
-    }
-
-    for (const int& c2 : kAlignmentCenters[version]) {
-      if (c2 == 0) {
-        break;
-      }
-
+  // Any combination of the values that doesn't land on a position detection
+  // pattern. Those on row or column 6 cross the timing patterns, and replace
+  // the stretch they cover.
+  const std::vector<int> centers = QRAttributes::AlignmentCenters(version);
+  for (const int c1 : centers) {
+    for (const int c2 : centers) {
       Point center(c1, c2);
       int off = modules_per_side * center.y + center.x;
-      if ((*type_map)[off] == QRAttributes::TYPE_DATA) {
+      if ((*type_map)[off] != QRAttributes::TYPE_POSITION_DETECTION_PATTERN) {
         WriteAlignmentBlock(center, modules_per_side, type_map.get());
       }
     }
@@ -113,10 +148,10 @@ QRAttributes::QRAttributes(int version, QRErrorCorrection ecc_level,
 
 absl::variant<std::unique_ptr<QRAttributes>, std::string> QRAttributes::New(
     int version, QRErrorCorrection level) {
-  if (version == 0 || version >= ABSL_ARRAYSIZE(kModulesPerSide)) {
+  if (version < 1 || version > kMaxVersion) {
     return absl::StrCat("unsupported/unknown version ", version);
   }
-  const int modules_per_side = kModulesPerSide[version];
+  const int modules_per_side = ModulesPerSide(version);
 
   auto type_map_result = MakeTypeMap(version, modules_per_side);
   if (absl::holds_alternative<std::string>(type_map_result)) {
@@ -140,6 +175,22 @@ absl::variant<std::unique_ptr<QRAttributes>, std::string> QRAttributes::New(
                                            error_characteristics));
 }
 
+int QRAttributes::ModulesPerSide(int version) { return 17 + 4 * version; }
+
+std::vector<int> QRAttributes::AlignmentCenters(int version) {
+  std::vector<int> centers;
+  if (version < 1 || version >= ABSL_ARRAYSIZE(kAlignmentCenters)) {
+    return centers;
+  }
+  for (const int c : kAlignmentCenters[version]) {
+    if (c == 0) {
+      break;
+    }
+    centers.push_back(c);
+  }
+  return centers;
+}
+
 QRAttributes::ModuleType QRAttributes::GetModuleType(Point p) const {
   if (p.x < 0 || p.y < 0 || p.x >= modules_per_side_ ||
       p.y >= modules_per_side_) {
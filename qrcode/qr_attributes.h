@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "qrcode/point.h"
 #include "qrcode/qr_error_characteristics.h"
@@ -30,6 +31,16 @@ class QRAttributes {
 
   ModuleType GetModuleType(Point p) const;
 
+  // Returns the number of modules along each side of codes of the given
+  // version.
+  static int ModulesPerSide(int version);
+
+  // Returns the rows (which are also the columns) of the alignment pattern
+  // centers in codes of the given version, in increasing order. A pattern
+  // sits at every pairing of them that doesn't overlap a positioning pattern.
+  // Empty for version 1 and unknown versions.
+  static std::vector<int> AlignmentCenters(int version);
+
   static char ModuleTypeToChar(ModuleType t);
 
   const QRErrorLevelCharacteristics& error_characteristics() const {
@@ -8,6 +8,7 @@
 namespace {
 
 using ::testing::_;
+using ::testing::ElementsAre;
 using ::testing::ElementsAreArray;
 using ::testing::VariantWith;
 
@@ -96,8 +97,83 @@ TEST(QRAttributesTest, TypeMapV2) {
   VerifyTypeMap(2, expected);
 }
 
+TEST(QRAttributesTest, TypeMapV7) {
+  auto result = QRAttributes::New(7, QRECC_M);
+  ASSERT_TRUE(absl::holds_alternative<std::unique_ptr<QRAttributes>>(result))
+      << absl::get<std::string>(result);
+  auto attributes = std::move(absl::get<std::unique_ptr<QRAttributes>>(result));
+  ASSERT_EQ(45, attributes->modules_per_side());
+
+  // The version blocks sit beside the bottom left and top right positioning
+  // blocks.
+  for (int along = 0; along < 6; ++along) {
+    for (int across = 34; across < 37; ++across) {
+      EXPECT_EQ(QRAttributes::TYPE_VERSION_INFORMATION,
+                attributes->GetModuleType(Point(along, across)))
+          << along << "," << across;
+      EXPECT_EQ(QRAttributes::TYPE_VERSION_INFORMATION,
+                attributes->GetModuleType(Point(across, along)))
+          << across << "," << along;
+    }
+  }
+  EXPECT_EQ(QRAttributes::TYPE_DATA, attributes->GetModuleType(Point(0, 33)));
+  EXPECT_EQ(QRAttributes::TYPE_DATA, attributes->GetModuleType(Point(7, 35)));
+
+  // Alignment patterns on row and column 6 cut across the timing patterns.
+  EXPECT_EQ(QRAttributes::TYPE_ALIGNMENT_PATTERN,
+            attributes->GetModuleType(Point(22, 6)));
+  EXPECT_EQ(QRAttributes::TYPE_ALIGNMENT_PATTERN,
+            attributes->GetModuleType(Point(6, 22)));
+  EXPECT_EQ(QRAttributes::TYPE_TIMING_PATTERN,
+            attributes->GetModuleType(Point(19, 6)));
+  EXPECT_EQ(QRAttributes::TYPE_ALIGNMENT_PATTERN,
+            attributes->GetModuleType(Point(22, 22)));
+}
+
+// Every version's data modules must hold exactly its codewords, plus the
+// remainder bits the spec pads it out with.
+TEST(QRAttributesTest, DataModules) {
+  for (int version = 1; version <= 40; ++version) {
+    auto result = QRAttributes::New(version, QRECC_L);
+    ASSERT_TRUE(absl::holds_alternative<std::unique_ptr<QRAttributes>>(result))
+        << absl::get<std::string>(result);
+    auto attributes =
+        std::move(absl::get<std::unique_ptr<QRAttributes>>(result));
+    ASSERT_EQ(QRAttributes::ModulesPerSide(version),
+              attributes->modules_per_side());
+
+    int num_data = 0;
+    for (int y = 0; y < attributes->modules_per_side(); ++y) {
+      for (int x = 0; x < attributes->modules_per_side(); ++x) {
+        num_data += attributes->GetModuleType(Point(x, y)) ==
+                    QRAttributes::TYPE_DATA;
+      }
+    }
+
+    int remainder_bits = 0;
+    if (version >= 2 && version <= 6) {
+      remainder_bits = 7;
+    } else if ((version >= 14 && version <= 20) ||
+               (version >= 28 && version <= 34)) {
+      remainder_bits = 3;
+    } else if (version >= 21 && version <= 27) {
+      remainder_bits = 4;
+    }
+
+    const QRErrorLevelCharacteristics& error_characteristics =
+        attributes->error_characteristics();
+    EXPECT_EQ((error_characteristics.total_data_codewords +
+               error_characteristics.total_ecc_codewords) *
+                      8 +
+                  remainder_bits,
+              num_data)
+        << version;
+  }
+}
+
 TEST(QRAttributesTest, OtherMethods) {
-  EXPECT_THAT(QRAttributes::New(7, QRECC_L), VariantWith<std::string>(_));
+  EXPECT_THAT(QRAttributes::New(0, QRECC_L), VariantWith<std::string>(_));
+  EXPECT_THAT(QRAttributes::New(41, QRECC_L), VariantWith<std::string>(_));
   EXPECT_THAT(QRAttributes::New(99, QRECC_L), VariantWith<std::string>(_));
 
   auto result = QRAttributes::New(5, QRECC_H);
@@ -115,4 +191,22 @@ TEST(QRAttributesTest, OtherMethods) {
   EXPECT_EQ(33, error_characteristics.block_sets[0].block_codewords);
 }
 
+TEST(QRAttributesTest, AlignmentCenters) {
+  EXPECT_THAT(QRAttributes::AlignmentCenters(1), ElementsAre());
+  EXPECT_THAT(QRAttributes::AlignmentCenters(2), ElementsAre(6, 18));
+  EXPECT_THAT(QRAttributes::AlignmentCenters(7), ElementsAre(6, 22, 38));
+  EXPECT_THAT(QRAttributes::AlignmentCenters(40),
+              ElementsAre(6, 30, 58, 86, 114, 142, 170));
+  EXPECT_THAT(QRAttributes::AlignmentCenters(41), ElementsAre());
+
+  // The last pattern always sits as far from the bottom right corner as the
+  // first does from the top left.
+  for (int version = 2; version <= 40; ++version) {
+    const std::vector<int> centers = QRAttributes::AlignmentCenters(version);
+    ASSERT_FALSE(centers.empty()) << version;
+    EXPECT_EQ(6, centers.front()) << version;
+    EXPECT_EQ(17 + 4 * version - 7, centers.back()) << version;
+  }
+}
+
 }  // namespace
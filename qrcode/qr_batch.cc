@@ -0,0 +1,100 @@
+#include "qrcode/qr_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+
+#include "qrcode/qr_extract.h"
+#include "qrcode/qr_perspective.h"
+
+namespace {
+
+// The width of a version 7 code, the smallest with more than one alignment
+// pattern.
+constexpr int kMinMultiAlignmentWidth = 45;
+
+// Reads a located code by normalizing it and following its timing patterns.
+absl::variant<std::unique_ptr<QRCodeArray>, std::string> NormalizeAndExtract(
+    cv::Mat image, const LocatedCode& located_code,
+    const NormalizeOptions& options, cv::Mat* scratch) {
+  auto maybe_qr_image = NormalizeCode(image, located_code, options, scratch);
+  if (absl::holds_alternative<std::string>(maybe_qr_image)) {
+    return absl::StrCat("failed to normalize code: ",
+                        absl::get<std::string>(maybe_qr_image));
+  }
+  std::unique_ptr<QRImage> qr_image =
+      std::move(absl::get<std::unique_ptr<QRImage>>(maybe_qr_image));
+
+  auto maybe_array = ExtractCode(*qr_image);
+  if (absl::holds_alternative<std::string>(maybe_array)) {
+    return absl::StrCat("failed to extract code: ",
+                        absl::get<std::string>(maybe_array));
+  }
+  return std::move(absl::get<std::unique_ptr<QRCodeArray>>(maybe_array));
+}
+
+}  // namespace
+
+DecodeResult DecodeLocatedCode(cv::Mat image, const LocatedCode& located_code,
+                               const NormalizeOptions& options,
+                               cv::Mat* scratch) {
+  // Over the width of a large code, a grid that only follows the timing
+  // patterns drifts away from the module centers. Codes with several
+  // alignment patterns are read along the grid they define instead, unless
+  // that fails.
+  std::unique_ptr<QRCodeArray> array;
+  auto maybe_perspective = ExtractCodeWithPerspective(image, located_code);
+  if (absl::holds_alternative<std::unique_ptr<QRCodeArray>>(
+          maybe_perspective) &&
+      absl::get<std::unique_ptr<QRCodeArray>>(maybe_perspective)->width() >=
+          kMinMultiAlignmentWidth) {
+    array = std::move(
+        absl::get<std::unique_ptr<QRCodeArray>>(maybe_perspective));
+  } else {
+    auto maybe_array =
+        NormalizeAndExtract(image, located_code, options, scratch);
+    if (absl::holds_alternative<std::string>(maybe_array)) {
+      return absl::get<std::string>(maybe_array);
+    }
+    array = std::move(absl::get<std::unique_ptr<QRCodeArray>>(maybe_array));
+  }
+
+  auto maybe_code = Decode(std::move(array));
+  if (absl::holds_alternative<std::string>(maybe_code)) {
+    return absl::StrCat("failed to decode code: ",
+                        absl::get<std::string>(maybe_code));
+  }
+  return std::move(absl::get<std::unique_ptr<QRCode>>(maybe_code));
+}
+
+std::vector<DecodeResult> DecodeLocatedCodes(
+    cv::Mat image, const std::vector<LocatedCode>& located_codes,
+    int num_threads, const NormalizeOptions& options) {
+  const int num_codes = located_codes.size();
+  std::vector<DecodeResult> results(num_codes);
+
+  // Codes are handed out one at a time, since some take much longer than
+  // others to fail.
+  std::atomic<int> next_code(0);
+  auto worker = [&]() {
+    cv::Mat scratch;
+    for (int i = next_code++; i < num_codes; i = next_code++) {
+      results[i] =
+          DecodeLocatedCode(image, located_codes[i], options, &scratch);
+    }
+  };
+
+  // The calling thread is one of the workers.
+  std::vector<std::thread> threads;
+  for (int i = 1; i < std::min(num_threads, num_codes); ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  return results;
+}
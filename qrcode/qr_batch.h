@@ -0,0 +1,37 @@
+#ifndef _QRCODE_QR_BATCH_H_
+#define _QRCODE_QR_BATCH_H_ 1
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/variant.h"
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/qr_decode.h"
+#include "qrcode/qr_locate.h"
+#include "qrcode/qr_normalize.h"
+
+// The outcome of decoding one located code: the code, or a description of the
+// step that failed.
+using DecodeResult = absl::variant<std::unique_ptr<QRCode>, std::string>;
+
+// Extracts and decodes a located code. image must be the black-and-white
+// image the code was located in. Codes of version 7 and up are read with
+// ExtractCodeWithPerspective, which follows their alignment patterns. Smaller
+// codes, and larger ones it can't read, are normalized and then extracted;
+// options and scratch are as for NormalizeCode.
+DecodeResult DecodeLocatedCode(cv::Mat image, const LocatedCode& located_code,
+                               const NormalizeOptions& options,
+                               cv::Mat* scratch);
+
+// Decodes each of the located codes, as DecodeLocatedCode does, spreading them
+// across num_threads threads. Values less than or equal to 1 decode on the
+// calling thread. Each thread has its own scratch image. The results are in
+// the same order as located_codes, and a code that fails doesn't stop the
+// others.
+std::vector<DecodeResult> DecodeLocatedCodes(
+    cv::Mat image, const std::vector<LocatedCode>& located_codes,
+    int num_threads, const NormalizeOptions& options = NormalizeOptions());
+
+#endif  // _QRCODE_QR_BATCH_H_
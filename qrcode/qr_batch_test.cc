@@ -0,0 +1,98 @@
+#include "qrcode/qr_batch.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "qrcode/qr_locate.h"
+
+namespace {
+
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::VariantWith;
+
+constexpr char kTestImageRelPath[] = "qrcode/testdata/straight.png";
+constexpr char kV10ImageRelPath[] = "qrcode/samples/unparseable_v10.png";
+
+TEST(DecodeLocatedCodesTest, Test) {
+  cv::Mat image = cv::imread(kTestImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(image.data != nullptr);
+
+  auto located = LocateCode(image);
+  ASSERT_THAT(located, VariantWith<std::unique_ptr<LocatedCode>>(_));
+  const LocatedCode good =
+      *absl::get<std::unique_ptr<LocatedCode>>(located).get();
+
+  // Positioning points in a corner of the image with nothing around them.
+  LocatedCode bad;
+  bad.positioning_points = {{10, 10}, {60, 10}, {10, 60}};
+  bad.center = {35, 35};
+  bad.rotation_angle = 0;
+
+  cv::Mat scratch;
+  auto expected = DecodeLocatedCode(image, good, NormalizeOptions(), &scratch);
+  ASSERT_THAT(expected, VariantWith<std::unique_ptr<QRCode>>(_))
+      << absl::get<std::string>(expected);
+  const QRCode& expected_code = *absl::get<std::unique_ptr<QRCode>>(expected);
+
+  const std::vector<LocatedCode> located_codes = {good, bad, good, good, bad};
+  for (bool crop : {false, true}) {
+    NormalizeOptions options;
+    options.crop_to_code = crop;
+
+    for (int num_threads : {1, 2, 8}) {
+      std::vector<DecodeResult> results =
+          DecodeLocatedCodes(image, located_codes, num_threads, options);
+      ASSERT_EQ(located_codes.size(), results.size());
+
+      for (int i = 0; i < results.size(); ++i) {
+        if (i == 1 || i == 4) {
+          EXPECT_THAT(results[i],
+                      VariantWith<std::string>(HasSubstr("failed")))
+              << "crop " << crop << " threads " << num_threads << " code "
+              << i;
+          continue;
+        }
+
+        ASSERT_THAT(results[i], VariantWith<std::unique_ptr<QRCode>>(_))
+            << "crop " << crop << " threads " << num_threads << " code " << i
+            << ": " << absl::get<std::string>(results[i]);
+        const QRCode& code = *absl::get<std::unique_ptr<QRCode>>(results[i]);
+        EXPECT_EQ(expected_code.attributes->version(),
+                  code.attributes->version());
+        EXPECT_EQ(expected_code.codewords, code.codewords);
+      }
+    }
+  }
+}
+
+// Large codes are read along the grid their alignment patterns define.
+TEST(DecodeLocatedCodesTest, LargeCode) {
+  cv::Mat gray = cv::imread(kV10ImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(gray.data != nullptr);
+  cv::Mat image;
+  cv::threshold(gray, image, 127, 255, cv::THRESH_BINARY);
+
+  auto located = LocateCode(image);
+  ASSERT_THAT(located, VariantWith<std::unique_ptr<LocatedCode>>(_));
+
+  const LocatedCode& located_code =
+      *absl::get<std::unique_ptr<LocatedCode>>(located);
+
+  cv::Mat scratch;
+  auto result =
+      DecodeLocatedCode(image, located_code, NormalizeOptions(), &scratch);
+  ASSERT_THAT(result, VariantWith<std::unique_ptr<QRCode>>(_))
+      << absl::get<std::string>(result);
+  const QRCode& code = *absl::get<std::unique_ptr<QRCode>>(result);
+  EXPECT_EQ(10, code.attributes->version());
+}
+
+TEST(DecodeLocatedCodesTest, Empty) {
+  cv::Mat image = cv::imread(kTestImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(image.data != nullptr);
+
+  EXPECT_TRUE(DecodeLocatedCodes(image, {}, 4).empty());
+}
+
+}  // namespace
@@ -7,24 +7,41 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 
+#include "qrcode/gf.h"
 #include "qrcode/qr_attributes.h"
 #include "qrcode/qr_decode_utils.h"
 #include "qrcode/qr_format.h"
+#include "qrcode/rs.h"
+
+namespace {
+
+// Codewords with a module read with less confidence than this are treated as
+// erasures during error correction.
+constexpr unsigned char kErasureConfidence = QRCodeArray::kCertain / 2;
+
+}  // namespace
 
 absl::variant<std::unique_ptr<QRCode>, std::string> Decode(
     std::unique_ptr<QRCodeArray> array) {
   // Version decode (ref algorithm steps 5 and 6)
   //   ((D/X)-10)/4, with X=1, D  measured from positioning point X centers
   //   (i.e. left+3).
-  const int version = ((array->width() - 6) - 10) / 4;
-  if (version > 6) {
-    // TODO: implement
-    return "large version decoding unimplemented";
+  int version = ((array->width() - 6) - 10) / 4;
+  if (version >= 7) {
+    // Larger codes say what version they are, which is more trustworthy than
+    // their measured size.
+    auto version_result = DecodeVersion(*array);
+    if (absl::holds_alternative<std::string>(version_result)) {
+      return "failed to decode version: " +
+             absl::get<std::string>(version_result);
+    }
+    version = absl::get<int>(version_result);
   }
 
   // Ref algorithm step 8 (finding the sampling grids using alignment patterns)
-  // skipped because we don't do version > 6. Also it would be in QRCodeArray
-  // construction.
+  // is up to whichever extractor built the array. ExtractCodeWithPerspective
+  // does it, and DecodeLocatedCode uses that for codes of version 7 and up;
+  // ExtractCode only follows the timing patterns.
 
   // Ref algorithm step 9 (sampling) skipped because we did it during
   // QRCodeArray construction.
@@ -57,10 +74,45 @@ absl::variant<std::unique_ptr<QRCode>, std::string> Decode(
 
   std::vector<CodewordBlock> codeword_blocks = SplitCodewordsIntoBlocks(
       attributes->error_characteristics(), FindCodewords(*attributes, *array));
+  const std::vector<CodewordBlock> confidence_blocks =
+      SplitCodewordsIntoBlocks(attributes->error_characteristics(),
+                               FindCodewordConfidences(*attributes, *array));
 
+  // Correct each block, then reassemble the data codewords.
+  FastGF256 gf256;
+  std::vector<int> corrected_codewords(codeword_blocks.size());
   std::vector<unsigned char> codewords;
   for (int i = 0; i < codeword_blocks.size(); ++i) {
-    std::copy(codeword_blocks[i].data.begin(), codeword_blocks[i].data.end(),
+    CodewordBlock& block = codeword_blocks[i];
+    std::vector<unsigned char> block_codewords = block.data;
+    block_codewords.insert(block_codewords.end(), block.ecc.begin(),
+                           block.ecc.end());
+
+    std::vector<unsigned char> confidences = confidence_blocks[i].data;
+    confidences.insert(confidences.end(), confidence_blocks[i].ecc.begin(),
+                       confidence_blocks[i].ecc.end());
+    std::vector<int> erasures;
+    for (int j = 0; j < confidences.size(); ++j) {
+      if (confidences[j] < kErasureConfidence) {
+        erasures.push_back(j);
+      }
+    }
+
+    auto rs_result =
+        DecodeRS(gf256, block.ecc.size(), erasures, &block_codewords);
+    if (absl::holds_alternative<std::string>(rs_result) && !erasures.empty()) {
+      // Too many codewords were suspect, or the suspicions were wrong.
+      // Without them we can still correct up to half as many errors.
+      rs_result = DecodeRS(gf256, block.ecc.size(), &block_codewords);
+    }
+    if (absl::holds_alternative<std::string>(rs_result)) {
+      return absl::StrFormat("failed to correct block %d: %s", i,
+                             absl::get<std::string>(rs_result));
+    }
+    corrected_codewords[i] = absl::get<int>(rs_result);
+
+    std::copy(block_codewords.begin(),
+              block_codewords.begin() + block.data.size(),
               std::back_inserter(codewords));
   }
 
@@ -68,5 +120,6 @@ absl::variant<std::unique_ptr<QRCode>, std::string> Decode(
   qrcode->attributes = std::move(attributes);
   qrcode->unmasked_array = std::move(array);
   qrcode->codewords = std::move(codewords);
+  qrcode->corrected_codewords = std::move(corrected_codewords);
   return std::move(qrcode);
 }
@@ -2,6 +2,8 @@
 #define _QRCODE_QR_DECODE_H_ 1
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/types/variant.h"
 
@@ -12,9 +14,17 @@
 struct QRCode {
   std::unique_ptr<QRAttributes> attributes;
   std::unique_ptr<QRCodeArray> unmasked_array;
+  // The data codewords, after error correction.
   std::vector<unsigned char> codewords;
+
+  // The number of codewords corrected in each block, in block order. Blocks
+  // that need more correction than others are the first sign of a fading or
+  // damaged print.
+  std::vector<int> corrected_codewords;
 };
 
+// Decodes an extracted code. Codewords holding modules that were read with
+// low confidence are treated as erasures when correcting errors.
 absl::variant<std::unique_ptr<QRCode>, std::string> Decode(
     std::unique_ptr<QRCodeArray> array);
 
@@ -6,16 +6,23 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+#include "qrcode/array_walker.h"
 #include "qrcode/qr_array.h"
+#include "qrcode/qr_attributes.h"
 #include "qrcode/testutils.h"
 
 namespace {
 
+using ::testing::Each;
+using ::testing::ElementsAre;
 using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+using ::testing::VariantWith;
 
 constexpr char kTestStraightRelPath[] = "qrcode/testdata/straight.txt";
 constexpr char kTestDataSpecExamplePath[] =
     "qrcode/testdata/spec_example_1m.txt";
+constexpr char kTestDataV10HPath[] = "qrcode/testdata/v10h.txt";
 
 class QRDecodeTest : public ::testing::Test {};
 
@@ -36,6 +43,122 @@ TEST_F(QRDecodeTest, Metadata) {
   EXPECT_EQ(QRECC_L, qrcode->attributes->ecc_level());
 }
 
+TEST_F(QRDecodeTest, VersionInformation) {
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ReadQRCodeArrayFromFile(kTestDataV10HPath),
+                   "read returned error");
+
+  auto result = Decode(std::move(array));
+  ASSERT_FALSE(absl::holds_alternative<std::string>(result))
+      << absl::get<std::string>(result);
+  std::unique_ptr<QRCode> qrcode =
+      std::move(absl::get<std::unique_ptr<QRCode>>(result));
+
+  EXPECT_EQ(57, qrcode->attributes->modules_per_side());
+  EXPECT_EQ(10, qrcode->attributes->version());
+  EXPECT_EQ(QRECC_H, qrcode->attributes->ecc_level());
+  EXPECT_EQ(122, qrcode->codewords.size());
+  EXPECT_THAT(qrcode->corrected_codewords, Each(0));
+}
+
+TEST_F(QRDecodeTest, CorrectsErrors) {
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> clean_array,
+                   ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
+                   "read returned error");
+  auto clean_result = Decode(std::move(clean_array));
+  ASSERT_FALSE(absl::holds_alternative<std::string>(clean_result))
+      << absl::get<std::string>(clean_result);
+  const std::vector<unsigned char> expected =
+      absl::get<std::unique_ptr<QRCode>>(clean_result)->codewords;
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
+                   "read returned error");
+
+  // Flip a module in each of two data codewords, in the bottom right corner
+  // where the first codeword starts.
+  for (const Point& p : {Point(20, 20), Point(20, 16)}) {
+    array->Set(p, !array->Get(p));
+  }
+
+  auto result = Decode(std::move(array));
+  ASSERT_FALSE(absl::holds_alternative<std::string>(result))
+      << absl::get<std::string>(result);
+  std::unique_ptr<QRCode> qrcode =
+      std::move(absl::get<std::unique_ptr<QRCode>>(result));
+
+  EXPECT_THAT(qrcode->codewords, ElementsAreArray(expected));
+  EXPECT_THAT(qrcode->corrected_codewords, ElementsAre(2));
+}
+
+// Modules read with low confidence make their codewords erasures, which can be
+// corrected twice as cheaply as errors.
+TEST_F(QRDecodeTest, CorrectsErasures) {
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> clean_array,
+                   ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
+                   "read returned error");
+  auto clean_result = Decode(std::move(clean_array));
+  ASSERT_FALSE(absl::holds_alternative<std::string>(clean_result))
+      << absl::get<std::string>(clean_result);
+  const std::vector<unsigned char> expected =
+      absl::get<std::unique_ptr<QRCode>>(clean_result)->codewords;
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRAttributes> attributes,
+                   QRAttributes::New(1, QRECC_M), "attributes returned error");
+
+  // Corrupt the first eight codewords, three more than the block's ten ECC
+  // codewords could correct without knowing where they are.
+  auto corrupt = [&](QRCodeArray* array, bool mark) {
+    ArrayWalker walker(*attributes);
+    for (int i = 0; i < 8 * 8; ++i) {
+      const Point p = *walker.Next();
+      if (i % 8 == 0) {
+        array->Set(p, !array->Get(p));
+        if (mark) {
+          array->SetConfidence(p, 0);
+        }
+      }
+    }
+  };
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> unmarked_array,
+                   ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
+                   "read returned error");
+  corrupt(unmarked_array.get(), false);
+  EXPECT_THAT(Decode(std::move(unmarked_array)),
+              VariantWith<std::string>(HasSubstr("failed to correct block")));
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
+                   "read returned error");
+  corrupt(array.get(), true);
+  auto result = Decode(std::move(array));
+  ASSERT_FALSE(absl::holds_alternative<std::string>(result))
+      << absl::get<std::string>(result);
+  std::unique_ptr<QRCode> qrcode =
+      std::move(absl::get<std::unique_ptr<QRCode>>(result));
+
+  EXPECT_THAT(qrcode->codewords, ElementsAreArray(expected));
+  EXPECT_THAT(qrcode->corrected_codewords, ElementsAre(8));
+}
+
+TEST_F(QRDecodeTest, TooManyErrors) {
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
+                   "read returned error");
+
+  // Wipe out the bottom right corner, which holds the first few codewords.
+  for (int y = 12; y < 21; ++y) {
+    for (int x = 15; x < 21; ++x) {
+      const Point p(x, y);
+      array->Set(p, !array->Get(p));
+    }
+  }
+
+  EXPECT_THAT(Decode(std::move(array)),
+              VariantWith<std::string>(HasSubstr("failed to correct block 0")));
+}
+
 TEST_F(QRDecodeTest, SpecExample) {
   ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
                    ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
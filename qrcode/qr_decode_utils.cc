@@ -1,5 +1,7 @@
 #include "qrcode/qr_decode_utils.h"
 
+#include <algorithm>
+
 #include "absl/types/span.h"
 
 #include "qrcode/array_walker.h"
@@ -9,10 +11,10 @@ void UnmaskArray(const QRAttributes& attributes, QRCodeArray* array,
   typedef std::function<bool(const Point&)> Unmasker;
   static Unmasker unmaskers[8] = {
       [](const Point& p) { return (p.x + p.y) % 2 == 0; },          // 000
-      [](const Point& p) { return p.x % 2 == 0; },                  // 001
-      [](const Point& p) { return p.y % 3 == 0; },                  // 010
+      [](const Point& p) { return p.y % 2 == 0; },                  // 001
+      [](const Point& p) { return p.x % 3 == 0; },                  // 010
       [](const Point& p) { return (p.x + p.y) % 3 == 0; },          // 011
-      [](const Point& p) { return (p.x / 2 + p.y / 3) % 2 == 0; },  // 100
+      [](const Point& p) { return (p.y / 2 + p.x / 3) % 2 == 0; },  // 100
       [](const Point& p) {
         return (p.x * p.y) % 2 + (p.x * p.y) % 3 == 0;
       },  // 101
@@ -66,6 +68,32 @@ std::vector<unsigned char> FindCodewords(const QRAttributes& attributes,
   return out;
 }
 
+std::vector<unsigned char> FindCodewordConfidences(
+    const QRAttributes& attributes, const QRCodeArray& array) {
+  ArrayWalker walker(attributes);
+  std::vector<unsigned char> out;
+
+  int num_bits = 0;
+  unsigned char cur_min = QRCodeArray::kCertain;
+  for (;;) {
+    absl::optional<Point> p = walker.Next();
+    if (!p.has_value()) {
+      break;
+    }
+
+    cur_min = std::min(cur_min, array.GetConfidence(*p));
+    num_bits++;
+
+    if (num_bits == 8) {
+      out.push_back(cur_min);
+      cur_min = QRCodeArray::kCertain;
+      num_bits = 0;
+    }
+  }
+
+  return out;
+}
+
 namespace {
 
 // BlockState contains the current state for a given ECC block. We keep two
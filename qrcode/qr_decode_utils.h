@@ -16,6 +16,12 @@ void UnmaskArray(const QRAttributes& attributes, QRCodeArray* array,
 std::vector<unsigned char> FindCodewords(const QRAttributes& attributes,
                                          const QRCodeArray& array);
 
+// Returns the confidence of each codeword found by FindCodewords, in the same
+// order: the lowest confidence of any of its modules. Like codewords, these
+// can be put into blocks with SplitCodewordsIntoBlocks.
+std::vector<unsigned char> FindCodewordConfidences(
+    const QRAttributes& attributes, const QRCodeArray& array);
+
 std::vector<unsigned char> OrderCodewords(
     const QRErrorLevelCharacteristics& error_characteristics,
     const std::vector<unsigned char>& unordered);
@@ -32,6 +32,15 @@ TEST(QRErrorTest, GetErrorCharacteristics) {
                         ElementsAre(BlockSetEq(MakeBlockSet(2, 33, 15)),
                                     BlockSetEq(MakeBlockSet(2, 34, 16)))))));
 
+  EXPECT_THAT(
+      GetErrorCharacteristics(40, QRECC_H),
+      VariantWith<QRErrorLevelCharacteristics>(AllOf(
+          Field(&QRErrorLevelCharacteristics::total_data_codewords, 1276),
+          Field(&QRErrorLevelCharacteristics::total_ecc_codewords, 2430),
+          Field(&QRErrorLevelCharacteristics::block_sets,
+                ElementsAre(BlockSetEq(MakeBlockSet(20, 45, 15)),
+                            BlockSetEq(MakeBlockSet(61, 46, 16)))))));
+
   EXPECT_THAT(GetErrorCharacteristics(99, QRECC_L),
               VariantWith<std::string>(HasSubstr("version 99 level QRECC_L")));
 }
@@ -1,5 +1,6 @@
 #include "qrcode/qr_extract.h"
 
+#include <algorithm>
 #include <tuple>
 
 #include "absl/memory/memory.h"
@@ -12,24 +13,32 @@
 
 namespace {
 
+// Returns the length of the run that begins at the iterator's position.
+template <class Directional>
+int RunLength(Directional iter) {
+  FixedRunner<1, Directional> runner(iter);
+  return (*runner.Next(1, nullptr))[0];
+}
+
 // Locates the outside ring of a positioning point, in a given
 // direction. Returns the position offset (relative to center) and the
 // width/height (as appropriate) of the ring at that point.
 //
 // delta_x and delta_y must be {-1,0,-1}, and one must be zero.
+template <class PixelIter>
 absl::optional<std::tuple<int, int>> GetPositioningOuterBorder(
-    PixelIterator<const uchar> iter, const Point& center, int delta_x,
-    int delta_y) {
+    PixelIter iter, const Point& center, int delta_x, int delta_y) {
+  using Directional = decltype(iter.MakeForwardRowIterator());
   iter.Seek(center);
-  const absl::optional<std::vector<int>> maybe_result =
-      Runner(DirectionalIterator<const uchar>(iter, delta_y, delta_x))
-          .Next(2, nullptr);
+  FixedRunner<2, Directional> runner(Directional(iter, delta_y, delta_x));
+  const absl::optional<absl::Span<const int>> maybe_result =
+      runner.Next(2, nullptr);
 
   if (!maybe_result.has_value()) {
     return absl::nullopt;
   }
 
-  const std::vector<int> runs = *maybe_result;
+  const absl::Span<const int> runs = *maybe_result;
   int off = 0;
   for (int i = 0; i < runs.size(); i++) {
     off += runs[i];
@@ -44,22 +53,26 @@ struct Extent {
   int len;
 };
 
+template <class PixelIter>
 absl::optional<std::vector<Extent>> FindPositioningPointExtents(
-    PixelIterator<const uchar> iter, const Point& center, bool lr) {
+    PixelIter iter, const Point& center, bool lr) {
+  using Directional = decltype(iter.MakeForwardRowIterator());
   iter.Seek(center);
-  auto back_iterator =
+  Directional back_iterator =
       lr ? iter.MakeReverseColumnIterator() : iter.MakeReverseRowIterator();
-  auto fwd_iterator =
+  Directional fwd_iterator =
       lr ? iter.MakeForwardColumnIterator() : iter.MakeForwardRowIterator();
 
-  auto maybe_back = Runner(back_iterator).Next(3, nullptr);
-  auto maybe_fwd = Runner(fwd_iterator).Next(3, nullptr);
+  FixedRunner<3, Directional> back_runner(back_iterator);
+  FixedRunner<3, Directional> fwd_runner(fwd_iterator);
+  auto maybe_back = back_runner.Next(3, nullptr);
+  auto maybe_fwd = fwd_runner.Next(3, nullptr);
   if (!maybe_back.has_value() || !maybe_fwd.has_value()) {
     return absl::nullopt;
   }
 
-  const std::vector<int>& back = *maybe_back;
-  const std::vector<int>& fwd = *maybe_fwd;
+  const absl::Span<const int> back = *maybe_back;
+  const absl::Span<const int> fwd = *maybe_fwd;
 
   int ref = lr ? center.x : center.y;
 
@@ -83,12 +96,11 @@ absl::optional<std::vector<Extent>> FindPositioningPointExtents(
   };
 }
 
+template <class PixelIter>
 absl::variant<std::vector<int>, std::string> FindXCoords(
-    const QRImage& qr_image) {
-  PixelIterator<const uchar> iter = PixelIteratorFromGrayImage(qr_image.image);
-
+    PixelIter iter, const PositioningPoints& positioning_points) {
   auto result = GetPositioningOuterBorder(
-      iter, qr_image.positioning_points.top_left, 0, 1);
+      iter, positioning_points.top_left, 0, 1);
   if (!result.has_value()) {
     return "failed to find h timing y";
   }
@@ -96,22 +108,21 @@ absl::variant<std::vector<int>, std::string> FindXCoords(
   int y_off, y_h;
   std::tie(y_off, y_h) = *result;
 
-  int h_timing_y = qr_image.positioning_points.top_left.y + y_off + y_h / 2;
+  int h_timing_y = positioning_points.top_left.y + y_off + y_h / 2;
 
-  iter.Seek(qr_image.positioning_points.top_left.x, h_timing_y);
-  int h_timing_left_x =
-      qr_image.positioning_points.top_left.x +
-      (*Runner(iter.MakeForwardColumnIterator()).Next(1, nullptr))[0];
+  iter.Seek(positioning_points.top_left.x, h_timing_y);
+  int h_timing_left_x = positioning_points.top_left.x +
+                        RunLength(iter.MakeForwardColumnIterator());
 
-  iter.Seek(qr_image.positioning_points.top_right.x, h_timing_y);
-  int h_timing_right_x =
-      qr_image.positioning_points.top_right.x -
-      (*Runner(iter.MakeReverseColumnIterator()).Next(1, nullptr))[0];
+  iter.Seek(positioning_points.top_right.x, h_timing_y);
+  int h_timing_right_x = positioning_points.top_right.x -
+                         RunLength(iter.MakeReverseColumnIterator());
 
   std::vector<Extent> timings;
 
   iter.Seek(h_timing_left_x, h_timing_y);
-  Runner runner(iter.MakeForwardColumnIterator());
+  FixedRunner<1, decltype(iter.MakeForwardColumnIterator())> runner(
+      iter.MakeForwardColumnIterator());
   for (int x = h_timing_left_x; x <= h_timing_right_x;) {
     auto maybe_run = runner.Next(1, nullptr);
     if (!maybe_run.has_value()) {
@@ -124,7 +135,7 @@ absl::variant<std::vector<int>, std::string> FindXCoords(
   }
 
   absl::optional<std::vector<Extent>> maybe_left_extents =
-      FindPositioningPointExtents(iter, qr_image.positioning_points.top_left,
+      FindPositioningPointExtents(iter, positioning_points.top_left,
                                   true);
   if (!maybe_left_extents.has_value()) {
     return "no top left extents";
@@ -133,7 +144,7 @@ absl::variant<std::vector<int>, std::string> FindXCoords(
                  maybe_left_extents->end());
 
   absl::optional<std::vector<Extent>> maybe_right_extents =
-      FindPositioningPointExtents(iter, qr_image.positioning_points.top_right,
+      FindPositioningPointExtents(iter, positioning_points.top_right,
                                   true);
   if (!maybe_right_extents.has_value()) {
     return "no top right extents";
@@ -149,12 +160,11 @@ absl::variant<std::vector<int>, std::string> FindXCoords(
   return x_coords;
 }
 
+template <class PixelIter>
 absl::variant<std::vector<int>, std::string> FindYCoords(
-    const QRImage& qr_image) {
-  PixelIterator<const uchar> iter = PixelIteratorFromGrayImage(qr_image.image);
-
+    PixelIter iter, const PositioningPoints& positioning_points) {
   auto result = GetPositioningOuterBorder(
-      iter, qr_image.positioning_points.top_left, 1, 0);
+      iter, positioning_points.top_left, 1, 0);
   if (!result.has_value()) {
     return "failed to find v timing x";
   }
@@ -162,22 +172,21 @@ absl::variant<std::vector<int>, std::string> FindYCoords(
   int x_off, x_w;
   std::tie(x_off, x_w) = *result;
 
-  int v_timing_x = qr_image.positioning_points.top_left.x + x_off + x_w / 2;
+  int v_timing_x = positioning_points.top_left.x + x_off + x_w / 2;
 
-  iter.Seek(v_timing_x, qr_image.positioning_points.top_left.y);
-  int v_timing_top_y =
-      qr_image.positioning_points.top_left.y +
-      (*Runner(iter.MakeForwardRowIterator()).Next(1, nullptr))[0];
+  iter.Seek(v_timing_x, positioning_points.top_left.y);
+  int v_timing_top_y = positioning_points.top_left.y +
+                       RunLength(iter.MakeForwardRowIterator());
 
-  iter.Seek(v_timing_x, qr_image.positioning_points.bottom_left.y);
-  int v_timing_bottom_y =
-      qr_image.positioning_points.bottom_left.y -
-      (*Runner(iter.MakeReverseRowIterator()).Next(1, nullptr))[0];
+  iter.Seek(v_timing_x, positioning_points.bottom_left.y);
+  int v_timing_bottom_y = positioning_points.bottom_left.y -
+                          RunLength(iter.MakeReverseRowIterator());
 
   std::vector<Extent> timings;
 
   iter.Seek(v_timing_x, v_timing_top_y);
-  Runner runner(iter.MakeForwardRowIterator());
+  FixedRunner<1, decltype(iter.MakeForwardRowIterator())> runner(
+      iter.MakeForwardRowIterator());
   for (int y = v_timing_top_y; y <= v_timing_bottom_y;) {
     auto maybe_run = runner.Next(1, nullptr);
     if (!maybe_run.has_value()) {
@@ -190,7 +199,7 @@ absl::variant<std::vector<int>, std::string> FindYCoords(
   }
 
   absl::optional<std::vector<Extent>> maybe_top_extents =
-      FindPositioningPointExtents(iter, qr_image.positioning_points.top_left,
+      FindPositioningPointExtents(iter, positioning_points.top_left,
                                   false);
   if (!maybe_top_extents.has_value()) {
     return "no top left v extents";
@@ -199,7 +208,7 @@ absl::variant<std::vector<int>, std::string> FindYCoords(
                  maybe_top_extents->end());
 
   absl::optional<std::vector<Extent>> maybe_bottom_extents =
-      FindPositioningPointExtents(iter, qr_image.positioning_points.bottom_left,
+      FindPositioningPointExtents(iter, positioning_points.bottom_left,
                                   false);
   if (!maybe_bottom_extents.has_value()) {
     return "no bottom left v extents";
@@ -215,10 +224,29 @@ absl::variant<std::vector<int>, std::string> FindYCoords(
   return y_coords;
 }
 
-}  // namespace
+// Returns how sure we are that the module centered at center is the color
+// its center pixel says, judged by the pixels reach_x and reach_y away from
+// it in each direction. Pixels off the edge of the image don't count.
+template <class PixelIter>
+unsigned char ModuleConfidence(PixelIter& iter, const Point& center,
+                               int reach_x, int reach_y, bool black) {
+  int agreeing = 0, total = 0;
+  for (int dy = -reach_y; dy <= reach_y; dy += reach_y) {
+    for (int dx = -reach_x; dx <= reach_x; dx += reach_x) {
+      if (!iter.Seek(center.x + dx, center.y + dy)) {
+        continue;
+      }
+      ++total;
+      agreeing += (iter.Get() == 0) == black;
+    }
+  }
+  return QRCodeArray::ConfidenceFromSamples(agreeing, total);
+}
 
-absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractCode(
-    const QRImage& qr_image) {
+// Reads the code's modules from iter, which walks the normalized image.
+template <class PixelIter>
+absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractModules(
+    PixelIter iter, const PositioningPoints& positioning_points) {
   // The timing marks are positioned as follows relative to the top
   // left positionining mark.
   //
@@ -241,14 +269,14 @@ absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractCode(
   // marks, assuming that the first long one is the top right
   // positioning mark. This seems both fiddly and fragile.
 
-  auto maybe_x_coords = FindXCoords(qr_image);
+  auto maybe_x_coords = FindXCoords(iter, positioning_points);
   if (absl::holds_alternative<std::string>(maybe_x_coords)) {
     return "x coords fail: " + absl::get<std::string>(maybe_x_coords);
   }
   const std::vector<int> x_coords =
       std::move(absl::get<std::vector<int>>(maybe_x_coords));
 
-  auto maybe_y_coords = FindYCoords(qr_image);
+  auto maybe_y_coords = FindYCoords(iter, positioning_points);
   if (absl::holds_alternative<std::string>(maybe_y_coords)) {
     return "y coords fail: " + absl::get<std::string>(maybe_y_coords);
   }
@@ -258,16 +286,39 @@ absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractCode(
   auto qr_array =
       absl::make_unique<QRCodeArray>(y_coords.size(), x_coords.size());
 
-  PixelIterator<const uchar> image_iter =
-      PixelIteratorFromGrayImage(qr_image.image);
+  // Confidence comes from pixels a quarter module from each module's center,
+  // which should still be inside it.
+  const int reach_x = std::max<int>(
+      1, (x_coords.back() - x_coords.front()) / (4 * (x_coords.size() - 1)));
+  const int reach_y = std::max<int>(
+      1, (y_coords.back() - y_coords.front()) / (4 * (y_coords.size() - 1)));
+
   for (int y = 0; y < y_coords.size(); ++y) {
     for (int x = 0; x < x_coords.size(); ++x) {
       Point image_point(x_coords[x], y_coords[y]);
       Point qr_point(x, y);
-      image_iter.Seek(image_point);
-      qr_array->Set(qr_point, image_iter.Get() == 0);
+      iter.Seek(image_point);
+      const bool black = iter.Get() == 0;
+      qr_array->Set(qr_point, black);
+      qr_array->SetConfidence(
+          qr_point,
+          ModuleConfidence(iter, image_point, reach_x, reach_y, black));
     }
   }
 
   return std::move(qr_array);
 }
+
+}  // namespace
+
+absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractCode(
+    const QRImage& qr_image) {
+  return ExtractModules(PixelIteratorFromGrayImage(qr_image.image),
+                        qr_image.positioning_points);
+}
+
+absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractCode(
+    const QRImageView& qr_image) {
+  return ExtractModules(RotatedPixelIterator(qr_image.image.get()),
+                        qr_image.positioning_points);
+}
@@ -13,4 +13,9 @@
 absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractCode(
     const QRImage& qr_image);
 
+// As above, for a normalized view. Only the pixels needed to find and read the
+// modules are computed.
+absl::variant<std::unique_ptr<QRCodeArray>, std::string> ExtractCode(
+    const QRImageView& qr_image);
+
 #endif  // _QRCODE_QR_EXTRACT_H_
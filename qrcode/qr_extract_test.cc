@@ -4,12 +4,15 @@
 #include "gtest/gtest.h"
 
 #include "qrcode/qr_array.h"
+#include "qrcode/qr_locate.h"
+#include "qrcode/qr_normalize.h"
 #include "qrcode/testutils.h"
 
 namespace {
 
 constexpr char kTestImageRelPath[] = "qrcode/testdata/straight.png";
 constexpr char kTestBitsRelPath[] = "qrcode/testdata/straight.txt";
+constexpr char kTiltImageRelPath[] = "qrcode/testdata/tilt.png";
 
 TEST(ExtractCode, Test) {
   QRImage qr_image;
@@ -36,6 +39,51 @@ TEST(ExtractCode, Test) {
       ASSERT_EQ(expected_array->Get(p), array->Get(p)) << p;
     }
   }
+
+  // Module centers well inside the positioning patterns can't be mistaken.
+  for (const Point& p : {Point(3, 3), Point(25, 3), Point(3, 25)}) {
+    EXPECT_EQ(QRCodeArray::kCertain, array->GetConfidence(p)) << p;
+  }
+}
+
+// Reading modules through a view must give the same code as reading them from
+// the straightened image.
+TEST(ExtractCode, View) {
+  for (const char* path : {kTestImageRelPath, kTiltImageRelPath}) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    ASSERT_TRUE(image.data != nullptr) << path;
+
+    ASSIGN_OR_ASSERT(std::unique_ptr<LocatedCode> located_code,
+                     LocateCode(image), "locate returned error");
+    ASSIGN_OR_ASSERT(std::unique_ptr<QRImage> qr_image,
+                     NormalizeCode(image, *located_code),
+                     "normalize returned error");
+    ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> expected_array,
+                     ExtractCode(*qr_image), "extract returned error");
+
+    std::unique_ptr<QRImageView> view = NormalizeCodeView(image, *located_code);
+    EXPECT_EQ(qr_image->positioning_points, view->positioning_points) << path;
+
+    ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array, ExtractCode(*view),
+                     "extract from view returned error");
+
+    ASSERT_EQ(expected_array->height(), array->height()) << path;
+    ASSERT_EQ(expected_array->width(), array->width()) << path;
+    int mismatches = 0;
+    for (int y = 0; y < expected_array->height(); ++y) {
+      for (int x = 0; x < expected_array->width(); ++x) {
+        Point p(x, y);
+        if (expected_array->Get(p) != array->Get(p)) {
+          ++mismatches;
+        }
+      }
+    }
+
+    // The view samples the nearest source pixel where cv::warpAffine
+    // interpolates, so a module right on an edge can come out differently.
+    // Decoding copes with the occasional one.
+    EXPECT_LE(mismatches, 2) << path;
+  }
 }
 
 }  // namespace
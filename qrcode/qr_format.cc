@@ -1,5 +1,11 @@
 #include "qrcode/qr_format.h"
 
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/base/macros.h"
+#include "absl/strings/str_cat.h"
+
 #include "qrcode/bch.h"
 #include "qrcode/gf.h"
 
@@ -48,6 +54,51 @@ QRErrorCorrection DecodeErrorCorrection(uint format_correction) {
   }
 }
 
+// The valid version information codewords, for versions 7 through 40. Each
+// is the version in the top six bits followed by its BCH(18,6) remainder.
+// From ISO/IEC 18004:2015 Annex D.
+constexpr int kFirstVersionWithInformation = 7;
+constexpr uint32_t kVersionCodewords[] = {
+    0x07C94, 0x085BC, 0x09A99, 0x0A4D3, 0x0BBF6, 0x0C762, 0x0D847,
+    0x0E60D, 0x0F928, 0x10B78, 0x1145D, 0x12A17, 0x13532, 0x149A6,
+    0x15683, 0x168C9, 0x177EC, 0x18EC4, 0x191E1, 0x1AFAB, 0x1B08E,
+    0x1CC1A, 0x1D33F, 0x1ED75, 0x1F250, 0x209D5, 0x216F0, 0x228BA,
+    0x2379F, 0x24B0B, 0x2542E, 0x26A64, 0x27541, 0x28C69,
+};
+
+// The codewords are at least eight bits apart, so up to three errors can be
+// corrected.
+constexpr int kMaxVersionErrors = 3;
+
+// Reads one copy of the version information. Bit i, counting from the least
+// significant, of the bottom left copy is at {i / 3, height - 11 + i % 3}.
+// The top right copy is its transpose.
+uint32_t ReadVersionCopy(const QRCodeArray& array, bool top_right) {
+  uint32_t bits = 0;
+  for (int i = 0; i < 18; ++i) {
+    const int along = i / 3;
+    const int across = array.width() - 11 + i % 3;
+    const Point point = top_right ? Point(across, along) : Point(along, across);
+    bits |= static_cast<uint32_t>(array.Get(point)) << i;
+  }
+  return bits;
+}
+
+// Returns the version whose codeword is nearest to bits, setting distance to
+// the number of bits they differ by.
+int NearestVersion(uint32_t bits, int* distance) {
+  int best = 0;
+  *distance = 32;
+  for (int i = 0; i < ABSL_ARRAYSIZE(kVersionCodewords); ++i) {
+    const int d = __builtin_popcount(bits ^ kVersionCodewords[i]);
+    if (d < *distance) {
+      best = i;
+      *distance = d;
+    }
+  }
+  return kFirstVersionWithInformation + best;
+}
+
 }  // namespace
 
 absl::variant<QRFormat, std::string> DecodeFormat(const QRCodeArray& array) {
@@ -116,3 +167,22 @@ absl::variant<QRFormat, std::string> DecodeFormat(const QRCodeArray& array) {
   decoded.mask_pattern = (format[2] << 2) | (format[1] << 1) | format[0];
   return decoded;
 }
+
+absl::variant<int, std::string> DecodeVersion(const QRCodeArray& array) {
+  if (array.width() != array.height() ||
+      array.width() < 17 + 4 * kFirstVersionWithInformation) {
+    return absl::StrCat("no version information in ", array.width(), "x",
+                        array.height(), " code");
+  }
+
+  int distance1, distance2;
+  const int version1 = NearestVersion(ReadVersionCopy(array, false),
+                                      &distance1);
+  const int version2 = NearestVersion(ReadVersionCopy(array, true),
+                                      &distance2);
+  if (std::min(distance1, distance2) > kMaxVersionErrors) {
+    return "failed to read valid version";
+  }
+
+  return distance1 <= distance2 ? version1 : version2;
+}
@@ -15,4 +15,9 @@ struct QRFormat {
 
 absl::variant<QRFormat, std::string> DecodeFormat(const QRCodeArray& array);
 
+// Decodes the version information blocks, which only codes of version 7 and
+// above have. The better of the two copies wins, and each may have up to
+// three bit errors.
+absl::variant<int, std::string> DecodeVersion(const QRCodeArray& array);
+
 #endif  // _QRCODE_QR_FORMAT_H_
@@ -1,13 +1,18 @@
 #include "qrcode/qr_format.h"
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 #include "qrcode/testutils.h"
 
 namespace {
 
+using ::testing::_;
+using ::testing::VariantWith;
+
 constexpr char kTestDataSpecExamplePath[] =
     "qrcode/testdata/spec_example_1m.txt";
+constexpr char kTestDataV10HPath[] = "qrcode/testdata/v10h.txt";
 
 class DecodeFormatTest : public ::testing::Test {
  public:
@@ -28,4 +33,59 @@ TEST_F(DecodeFormatTest, Test) {
   EXPECT_EQ(0b011, format.mask_pattern);
 }
 
+class DecodeVersionTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    ASSIGN_OR_ASSERT(base_, ReadQRCodeArrayFromFile(kTestDataV10HPath),
+                     "read failed");
+  }
+
+  // Flips num bits of the bottom left version block.
+  void FlipBottomLeft(int num) {
+    for (int i = 0; i < num; ++i) {
+      const Point p(i / 3, base_->height() - 11 + i % 3);
+      base_->Set(p, !base_->Get(p));
+    }
+  }
+
+  // Flips num bits of the top right version block.
+  void FlipTopRight(int num) {
+    for (int i = 0; i < num; ++i) {
+      const Point p(base_->width() - 11 + i % 3, i / 3);
+      base_->Set(p, !base_->Get(p));
+    }
+  }
+
+  std::unique_ptr<QRCodeArray> base_;
+};
+
+TEST_F(DecodeVersionTest, Test) {
+  EXPECT_THAT(DecodeVersion(*base_), VariantWith<int>(10));
+}
+
+TEST_F(DecodeVersionTest, Correctable) {
+  FlipBottomLeft(3);
+  FlipTopRight(3);
+  EXPECT_THAT(DecodeVersion(*base_), VariantWith<int>(10));
+}
+
+TEST_F(DecodeVersionTest, OneCopyUncorrectable) {
+  FlipBottomLeft(5);
+  EXPECT_THAT(DecodeVersion(*base_), VariantWith<int>(10));
+}
+
+TEST_F(DecodeVersionTest, Uncorrectable) {
+  FlipBottomLeft(4);
+  FlipTopRight(4);
+  EXPECT_THAT(DecodeVersion(*base_),
+              VariantWith<std::string>("failed to read valid version"));
+}
+
+TEST(DecodeVersionSmallTest, Test) {
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ReadQRCodeArrayFromFile(kTestDataSpecExamplePath),
+                   "read failed");
+  EXPECT_THAT(DecodeVersion(*array), VariantWith<std::string>(_));
+}
+
 }  // namespace
@@ -1,7 +1,13 @@
 #include "qrcode/qr_locate.h"
 
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <thread>
 #include <vector>
 
 #include "absl/base/macros.h"
@@ -13,50 +19,300 @@
 #include "qrcode/qr_utils.h"
 #include "qrcode/runner.h"
 
-absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateCode(
-    cv::Mat image) {
-  PixelIterator<const uchar> image_iter = PixelIteratorFromGrayImage(image);
-  std::vector<Point> candidates;
-  for (int row = 0; row < image.rows; ++row) {
-    auto row_candidates = FindPositioningPointCandidatesInRow(&image_iter, row);
-    candidates.insert(candidates.end(), row_candidates.begin(),
-                      row_candidates.end());
-  }
-
-  if (candidates.size() < 3) {
-    return absl::StrFormat("want 3 positioning blocks, found %d",
-                           candidates.size());
-  }
-
-  // The threshold for clustering candidate positioning block centers. We can
-  // get away with 10 if the code is already properly oriented, but we need a
-  // bigger threshold to cover angled cases where our ratio detection might have
-  // a harder time.
-  constexpr int kPositioningBlockClusteringThreshold = 50;
-
-  absl::optional<std::vector<Point>> maybe_clusters =
-      ClusterPoints(candidates, kPositioningBlockClusteringThreshold, 3);
-  if (!maybe_clusters.has_value()) {
-    return "clustering failed: too many clusters";
-  } else if (maybe_clusters->size() != 3) {
+namespace {
+
+// The threshold for clustering candidate positioning block centers. We can get
+// away with 10 if the code is already properly oriented, but we need a bigger
+// threshold to cover angled cases where our ratio detection might have a
+// harder time.
+constexpr int kPositioningBlockClusteringThreshold = 50;
+
+// Finds the positioning point candidates in a single row. Must be safe to call
+// from several threads at once.
+using RowScanner = std::function<std::vector<Point>(int row)>;
+
+// Receives the candidates found in each scanned row, one row at a time, in
+// row order. Returns true if the scan should stop.
+using RowConsumer =
+    std::function<bool(int row, const std::vector<Point>& candidates)>;
+
+// Scans rows [0, num_rows) using num_threads threads, handing each row's
+// candidates to consume. Returns the number of rows scanned, which is less
+// than num_rows if consume stopped the scan.
+int ScanRows(const RowScanner& scan_row, int num_rows, int num_threads,
+             const RowConsumer& consume) {
+  if (num_threads <= 1) {
+    for (int row = 0; row < num_rows; ++row) {
+      if (consume(row, scan_row(row))) {
+        return row + 1;
+      }
+    }
+    return num_rows;
+  }
+
+  // Use more bands than threads so a thread that draws a band full of
+  // candidates doesn't hold up the others.
+  constexpr int kBandsPerThread = 4;
+  const int num_bands = std::min(num_rows, num_threads * kBandsPerThread);
+
+  // Each band keeps its rows' candidates until every band above it has been
+  // consumed, so consume sees them in row order no matter which thread
+  // scanned which band.
+  std::vector<std::vector<std::vector<Point>>> band_rows(num_bands);
+  std::vector<char> band_done(num_bands, false);
+  int next_to_consume = 0;
+  std::mutex mu;  // Guards band_done, next_to_consume, and calls to consume.
+
+  std::atomic<bool> stop(false);
+  std::atomic<int> rows_scanned(0);
+  std::atomic<int> next_band(0);
+  auto worker = [&]() {
+    for (int band = next_band++; band < num_bands && !stop;
+         band = next_band++) {
+      const int start_row = static_cast<long>(num_rows) * band / num_bands;
+      const int end_row = static_cast<long>(num_rows) * (band + 1) / num_bands;
+      std::vector<std::vector<Point>>& rows = band_rows[band];
+      rows.reserve(end_row - start_row);
+      for (int row = start_row; row < end_row && !stop; ++row) {
+        rows.push_back(scan_row(row));
+        ++rows_scanned;
+      }
+
+      std::lock_guard<std::mutex> lock(mu);
+      band_done[band] = true;
+      while (!stop && next_to_consume < num_bands &&
+             band_done[next_to_consume]) {
+        const int start_row =
+            static_cast<long>(num_rows) * next_to_consume / num_bands;
+        const std::vector<std::vector<Point>>& rows =
+            band_rows[next_to_consume];
+        for (int i = 0; i < rows.size(); ++i) {
+          if (consume(start_row + i, rows[i])) {
+            stop = true;
+            break;
+          }
+        }
+        ++next_to_consume;
+      }
+    }
+  };
+
+  // The calling thread is one of the workers.
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  return rows_scanned;
+}
+
+// Returns the rows of an image with num_rows rows that the coarse-to-fine
+// search must scan in full, after a coarse pass over every step-th row.
+std::vector<int> FindFineRows(const RowScanner& scan_row, int num_rows,
+                              int step, int num_threads) {
+  // The coarse pass only needs to know which of its rows had candidates.
+  const int num_coarse_rows = (num_rows + step - 1) / step;
+  std::vector<char> coarse_hits(num_coarse_rows, false);
+  ScanRows(
+      [&](int i) {
+        std::vector<Point> candidates = scan_row(i * step);
+        coarse_hits[i] = !candidates.empty();
+        return candidates;
+      },
+      num_coarse_rows, num_threads,
+      [](int row, const std::vector<Point>& candidates) { return false; });
+
+  // A positioning point found on a coarse row may also be crossed by any of
+  // the rows between it and its neighboring coarse rows. Rescan all of those,
+  // in order, so the candidates come out as a full scan would order them.
+  std::vector<int> fine_rows;
+  for (int row = 0; row < num_rows; ++row) {
+    const int below = row / step;
+    const int above = (row + step - 1) / step;
+    if (coarse_hits[below] || (above < num_coarse_rows && coarse_hits[above])) {
+      fine_rows.push_back(row);
+    }
+  }
+  return fine_rows;
+}
+
+// Turns a set of positioning points into a located code.
+LocatedCode MakeLocatedCode(const PositioningPoints& positioning_points) {
+  LocatedCode located_code;
+  located_code.positioning_points = positioning_points;
+  located_code.center = CalculateCodeCenter(positioning_points);
+  located_code.rotation_angle = CalculateCodeRotationAngle(positioning_points);
+  return located_code;
+}
+
+// Turns clusters of positioning point candidates into a located code. Noise
+// can add clusters of its own, so the three with the most support are taken
+// to be the positioning points.
+absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateFromClusters(
+    const std::vector<PointCluster>& clusters) {
+  if (clusters.size() < 3) {
     return absl::StrFormat("clustering failed: wanted 3 clusters, got %d",
-                           maybe_clusters->size());
+                           clusters.size());
   }
 
-  const std::vector<Point> clusters = std::move(maybe_clusters.value());
+  std::vector<int> indexes(clusters.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  std::stable_sort(indexes.begin(), indexes.end(), [&](int a, int b) {
+    return clusters[a].support > clusters[b].support;
+  });
+  indexes.resize(3);
+  std::sort(indexes.begin(), indexes.end());
 
   absl::optional<PositioningPoints> maybe_positioning_points =
-      OrderPositioningPoints(clusters[0], clusters[1], clusters[2]);
+      OrderPositioningPoints(clusters[indexes[0]].Center(),
+                             clusters[indexes[1]].Center(),
+                             clusters[indexes[2]].Center());
   if (!maybe_positioning_points.has_value()) {
     return "failed to find correct ordering";
   }
 
-  auto located_code = absl::make_unique<LocatedCode>();
-  located_code->positioning_points =
-      std::move(maybe_positioning_points.value());
-  located_code->center = CalculateCodeCenter(located_code->positioning_points);
-  located_code->rotation_angle =
-      CalculateCodeRotationAngle(located_code->positioning_points);
+  return absl::make_unique<LocatedCode>(
+      MakeLocatedCode(maybe_positioning_points.value()));
+}
+
+// Scans an image with num_rows rows as directed by options, and clusters the
+// positioning point candidates it finds. If the scan stops early, the points
+// it settled on are stored in *early_points. If early_points is null, the
+// scan never stops early.
+std::vector<PointCluster> FindClusters(
+    const RowScanner& scan_row, int num_rows, const LocateOptions& options,
+    absl::optional<PositioningPoints>* early_points) {
+  LocateStats stats;
+
+  // Unless the search is coarse-to-fine, the final pass covers every row.
+  RowScanner final_scan_row = scan_row;
+  int num_final_rows = num_rows;
+  std::vector<int> fine_rows;
+  if (options.row_step > 1) {
+    fine_rows =
+        FindFineRows(scan_row, num_rows, options.row_step, options.num_threads);
+    final_scan_row = [&](int i) { return scan_row(fine_rows[i]); };
+    num_final_rows = fine_rows.size();
+    stats.rows_scanned += (num_rows + options.row_step - 1) / options.row_step;
+  }
+
+  PointClusterer clusterer(kPositioningBlockClusteringThreshold);
+  const int rows_scanned = ScanRows(
+      final_scan_row, num_final_rows, options.num_threads,
+      [&](int i, const std::vector<Point>& row_candidates) {
+        const int row = options.row_step > 1 ? fine_rows[i] : i;
+        for (const Point& point : row_candidates) {
+          clusterer.Add(point, row);
+        }
+        if (early_points == nullptr || options.early_stop_hits <= 0) {
+          return false;
+        }
+
+        *early_points =
+            clusterer.FindPositioningPoints(options.early_stop_hits, row + 1);
+        return early_points->has_value();
+      });
+
+  stats.rows_scanned += rows_scanned;
+  stats.rows_skipped = num_final_rows - rows_scanned;
+  if (options.stats != nullptr) {
+    *options.stats = stats;
+  }
+
+  return clusterer.clusters();
+}
+
+// Locates the code in an image with num_rows rows, as directed by options.
+absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateWithOptions(
+    const RowScanner& scan_row, int num_rows, const LocateOptions& options) {
+  absl::optional<PositioningPoints> early_points;
+  std::vector<PointCluster> clusters =
+      FindClusters(scan_row, num_rows, options, &early_points);
+  if (early_points.has_value()) {
+    return absl::make_unique<LocatedCode>(
+        MakeLocatedCode(early_points.value()));
+  }
+  return LocateFromClusters(clusters);
+}
+
+// Locates every code in an image with num_rows rows, as directed by options.
+std::vector<LocatedCode> LocateAllWithOptions(const RowScanner& scan_row,
+                                              int num_rows,
+                                              const LocateOptions& options) {
+  // There's no telling how many codes are left in the rows an early stop
+  // would skip, so don't ask for one.
+  std::vector<LocatedCode> located_codes;
+  for (const PositioningPoints& points : GroupPositioningPoints(
+           FindClusters(scan_row, num_rows, options, nullptr))) {
+    located_codes.push_back(MakeLocatedCode(points));
+  }
+  return located_codes;
+}
+
+// Returns a row scanner for image, which reads options.run_length_image
+// instead if it's set.
+RowScanner MakeRowScanner(const cv::Mat& image, const LocateOptions& options) {
+  if (options.run_length_image != nullptr) {
+    return [&](int row) {
+      return FindPositioningPointCandidatesInRow(*options.run_length_image,
+                                                 row);
+    };
+  }
+
+  return [&](int row) {
+    PixelIterator<const uchar> image_iter = PixelIteratorFromGrayImage(image);
+    return FindPositioningPointCandidatesInRow(&image_iter, row);
+  };
+}
+
+RowScanner MakeRowScanner(const BitImage& image) {
+  return [&](int row) {
+    BitPixelIterator image_iter(&image);
+    return FindPositioningPointCandidatesInRow(&image_iter, row);
+  };
+}
+
+RowScanner MakeRowScanner(const LazyBinaryImage& image) {
+  return [&](int row) {
+    LazyPixelIterator image_iter(&image);
+    return FindPositioningPointCandidatesInRow(&image_iter, row);
+  };
+}
+
+}  // namespace
+
+absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateCode(
+    cv::Mat image, const LocateOptions& options) {
+  return LocateWithOptions(MakeRowScanner(image, options), image.rows,
+                           options);
+}
+
+absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateCode(
+    const BitImage& image, const LocateOptions& options) {
+  return LocateWithOptions(MakeRowScanner(image), image.height(), options);
+}
+
+absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateCode(
+    const LazyBinaryImage& image, const LocateOptions& options) {
+  return LocateWithOptions(MakeRowScanner(image), image.height(), options);
+}
+
+std::vector<LocatedCode> LocateCodes(cv::Mat image,
+                                     const LocateOptions& options) {
+  return LocateAllWithOptions(MakeRowScanner(image, options), image.rows,
+                              options);
+}
+
+std::vector<LocatedCode> LocateCodes(const BitImage& image,
+                                     const LocateOptions& options) {
+  return LocateAllWithOptions(MakeRowScanner(image), image.height(), options);
+}
 
-  return std::move(located_code);
+std::vector<LocatedCode> LocateCodes(const LazyBinaryImage& image,
+                                     const LocateOptions& options) {
+  return LocateAllWithOptions(MakeRowScanner(image), image.height(), options);
 }
@@ -2,12 +2,16 @@
 #define _QRCODE_QR_LOCATE_H_ 1
 
 #include <memory>
+#include <vector>
 
 #include "absl/types/variant.h"
 #include "opencv2/opencv.hpp"
 
+#include "qrcode/bit_image.h"
+#include "qrcode/lazy_binary_image.h"
 #include "qrcode/point.h"
 #include "qrcode/qr_types.h"
+#include "qrcode/run_length_image.h"
 
 // Describes the location and orientation of a QR code in an image.
 struct LocatedCode {
@@ -16,8 +20,77 @@ struct LocatedCode {
   double rotation_angle;
 };
 
+// Reports on the work done by LocateCode.
+struct LocateStats {
+  // The number of rows scanned for positioning point candidates, counting both
+  // passes of a coarse-to-fine search.
+  int rows_scanned = 0;
+
+  // The number of rows left unscanned because the search stopped early.
+  int rows_skipped = 0;
+};
+
+// Controls how LocateCode searches the image.
+struct LocateOptions {
+  // The number of threads used to scan rows for positioning point
+  // candidates. The image is split into bands of rows which are handed out to
+  // the threads. Values less than or equal to 1 scan on the calling thread.
+  // The result is the same regardless of the number of threads.
+  int num_threads = 1;
+
+  // If set, positioning point candidates are found by querying these runs
+  // rather than by walking the image's pixels. They must have been built from
+  // the image passed to LocateCode, with column tables. Not owned.
+  const RunLengthImage* run_length_image = nullptr;
+
+  // If greater than 1, the search is done coarse-to-fine: a first pass scans
+  // only every row_step-th row, and a second scans every row, but only within
+  // row_step rows of the rows where the first pass found candidates. Every
+  // positioning point is still found as long as row_step is no more than the
+  // height of a positioning point's center (three modules), and the search
+  // does about 1/row_step of the work on images where codes are sparse.
+  int row_step = 1;
+
+  // If greater than 0, the search stops as soon as exactly three clusters of
+  // candidates have at least this many hits each, the scan has moved far
+  // enough past them that they can't grow, and they are arranged like the
+  // positioning points of a code. The rest of the image is not scanned, and
+  // any clusters it would have added are ignored. If the scan reaches the end
+  // of the image without stopping, the code is located as if this were 0.
+  int early_stop_hits = 0;
+
+  // If set, filled in with statistics about the search. Not owned.
+  LocateStats* stats = nullptr;
+};
+
 // Attempts to locate a single QR code in a black-and-white image.
 absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateCode(
-    cv::Mat image);
+    cv::Mat image, const LocateOptions& options = LocateOptions());
+
+// As above, for a bit-packed image. options.run_length_image is ignored.
+absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateCode(
+    const BitImage& image, const LocateOptions& options = LocateOptions());
+
+// As above, for a lazily thresholded image. Only the tiles that the search
+// reads are thresholded. options.run_length_image is ignored.
+absl::variant<std::unique_ptr<LocatedCode>, std::string> LocateCode(
+    const LazyBinaryImage& image,
+    const LocateOptions& options = LocateOptions());
+
+// Locates every QR code in a black-and-white image, in a single scan. Codes
+// are returned in the order their first positioning points were found, and
+// the result is empty if there are none. options.early_stop_hits is ignored.
+std::vector<LocatedCode> LocateCodes(
+    cv::Mat image, const LocateOptions& options = LocateOptions());
+
+// As above, for a bit-packed image. options.run_length_image is ignored.
+std::vector<LocatedCode> LocateCodes(
+    const BitImage& image, const LocateOptions& options = LocateOptions());
+
+// As above, for a lazily thresholded image. options.run_length_image is
+// ignored.
+std::vector<LocatedCode> LocateCodes(
+    const LazyBinaryImage& image,
+    const LocateOptions& options = LocateOptions());
 
 #endif  // _QRCODE_QR_LOCATE_H_
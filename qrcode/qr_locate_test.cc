@@ -1,5 +1,7 @@
 #include "qrcode/qr_locate.h"
 
+#include <cmath>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -7,6 +9,7 @@ namespace {
 
 using ::testing::_;
 using ::testing::DoubleNear;
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::VariantWith;
 
@@ -16,11 +19,12 @@ constexpr char kStraightImageRelPath[] = "qrcode/testdata/straight.png";
 class LocateCodeTest : public ::testing::Test {
  public:
   void TestImage(const std::string& path, const PositioningPoints& points,
-                 const Point& center, double rotation_angle) {
+                 const Point& center, double rotation_angle,
+                 const LocateOptions& options = LocateOptions()) {
     cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
     ASSERT_TRUE(image.data != nullptr) << path;
 
-    auto result = LocateCode(image);
+    auto result = LocateCode(image, options);
     ASSERT_THAT(result, VariantWith<std::unique_ptr<LocatedCode>>(_))
         << "had string: " << absl::get<std::string>(result);
     std::unique_ptr<LocatedCode> located_code =
@@ -35,13 +39,13 @@ class LocateCodeTest : public ::testing::Test {
 
 TEST_F(LocateCodeTest, Straight) {
   PositioningPoints expected_points = {
-      {668, 684},
+      {669, 684},
       {1526, 677},
-      {672, 1542},
+      {671, 1542},
   };
 
-  Point expected_center(1099, 1110);
-  double expected_angle = 0.267;
+  Point expected_center(1098, 1110);
+  double expected_angle = 0.134;
 
   TestImage(kStraightImageRelPath, expected_points, expected_center,
             expected_angle);
@@ -49,16 +53,292 @@ TEST_F(LocateCodeTest, Straight) {
 
 TEST_F(LocateCodeTest, Tilt) {
   PositioningPoints expected_points = {
-      {1015, 513},
-      {1710, 1018},
-      {506, 1203},
+      {1008, 508},
+      {1700, 1012},
+      {499, 1199},
   };
 
-  Point expected_center(1107, 1110);
+  Point expected_center(1099, 1106);
   double expected_angle = -36.4;
 
   TestImage(kTiltImageRelPath, expected_points, expected_center,
             expected_angle);
 }
 
+// The threaded scan must find exactly what the single-threaded scan does.
+TEST_F(LocateCodeTest, Threaded) {
+  for (int num_threads : {2, 3, 8}) {
+    LocateOptions options;
+    options.num_threads = num_threads;
+
+    TestImage(kStraightImageRelPath, {{669, 684}, {1526, 677}, {671, 1542}},
+              Point(1098, 1110), 0.134, options);
+    TestImage(kTiltImageRelPath, {{1008, 508}, {1700, 1012}, {499, 1199}},
+              Point(1099, 1106), -36.4, options);
+  }
+}
+
+// The coarse-to-fine search must find the same positioning points as the full
+// scan.
+TEST_F(LocateCodeTest, RowStep) {
+  for (int row_step : {2, 4, 16}) {
+    for (int num_threads : {1, 4}) {
+      LocateOptions options;
+      options.row_step = row_step;
+      options.num_threads = num_threads;
+
+      TestImage(kStraightImageRelPath, {{669, 684}, {1526, 677}, {671, 1542}},
+                Point(1098, 1110), 0.134, options);
+      TestImage(kTiltImageRelPath, {{1008, 508}, {1700, 1012}, {499, 1199}},
+                Point(1099, 1106), -36.4, options);
+    }
+  }
+}
+
+// Stopping early must find the same positioning points as the full scan,
+// without scanning the whole image.
+TEST_F(LocateCodeTest, EarlyStop) {
+  LocateStats stats;
+  LocateOptions options;
+  options.early_stop_hits = 3;
+  options.stats = &stats;
+
+  TestImage(kStraightImageRelPath, {{669, 684}, {1526, 677}, {671, 1542}},
+            Point(1098, 1110), 0.134, options);
+  EXPECT_GT(stats.rows_skipped, 0);
+
+  TestImage(kTiltImageRelPath, {{1008, 508}, {1700, 1012}, {499, 1199}},
+            Point(1099, 1106), -36.4, options);
+  EXPECT_GT(stats.rows_skipped, 0);
+}
+
+// Whether or not threaded and coarse-to-fine searches get to skip anything,
+// stopping early mustn't change what they find.
+TEST_F(LocateCodeTest, EarlyStopWithOtherOptions) {
+  for (int row_step : {1, 4}) {
+    for (int num_threads : {1, 4}) {
+      LocateOptions options;
+      options.row_step = row_step;
+      options.num_threads = num_threads;
+      options.early_stop_hits = 3;
+
+      TestImage(kStraightImageRelPath, {{669, 684}, {1526, 677}, {671, 1542}},
+                Point(1098, 1110), 0.134, options);
+      TestImage(kTiltImageRelPath, {{1008, 508}, {1700, 1012}, {499, 1199}},
+                Point(1099, 1106), -36.4, options);
+    }
+  }
+}
+
+TEST_F(LocateCodeTest, Stats) {
+  cv::Mat image = cv::imread(kStraightImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(image.data != nullptr);
+
+  LocateStats stats;
+  LocateOptions options;
+  options.stats = &stats;
+  LocateCode(image, options);
+  EXPECT_EQ(image.rows, stats.rows_scanned);
+  EXPECT_EQ(0, stats.rows_skipped);
+}
+
+// Draws a positioning block with the given center and module size.
+void DrawPositioningBlock(cv::Mat* image, const Point& center, int module) {
+  const int x0 = center.x - module * 7 / 2;
+  const int y0 = center.y - module * 7 / 2;
+  for (int my = 0; my < 7; ++my) {
+    for (int mx = 0; mx < 7; ++mx) {
+      const bool ring = mx == 0 || mx == 6 || my == 0 || my == 6;
+      const bool middle = mx >= 2 && mx <= 4 && my >= 2 && my <= 4;
+      if (!ring && !middle) {
+        continue;
+      }
+
+      for (int y = 0; y < module; ++y) {
+        for (int x = 0; x < module; ++x) {
+          image->at<uchar>(y0 + my * module + y, x0 + mx * module + x) = 0;
+        }
+      }
+    }
+  }
+}
+
+// Draws the positioning blocks of an upright code whose top left positioning
+// point is at top_left.
+void DrawCode(cv::Mat* image, const Point& top_left, int module, int side) {
+  const int span = (side - 7) * module;
+  DrawPositioningBlock(image, top_left, module);
+  DrawPositioningBlock(image, {top_left.x + span, top_left.y}, module);
+  DrawPositioningBlock(image, {top_left.x, top_left.y + span}, module);
+}
+
+// Draws the positioning blocks of a code whose top left positioning point is
+// at top_left, rotated clockwise by degrees about that point.
+void DrawRotatedCode(cv::Mat* image, const Point& top_left, int module,
+                     int side, double degrees) {
+  const double radians = degrees * M_PI / 180.0;
+  const double cos_a = std::cos(radians);
+  const double sin_a = std::sin(radians);
+  const int span = (side - 7) * module;
+
+  for (int y = 0; y < image->rows; ++y) {
+    for (int x = 0; x < image->cols; ++x) {
+      // Rotate back to the upright code, relative to the top left point.
+      const double u = (x - top_left.x) * cos_a + (y - top_left.y) * sin_a;
+      const double v = -(x - top_left.x) * sin_a + (y - top_left.y) * cos_a;
+      for (const Point& block : {Point(0, 0), Point(span, 0), Point(0, span)}) {
+        const int mx = std::floor((u - block.x) / module + 3.5);
+        const int my = std::floor((v - block.y) / module + 3.5);
+        if (mx < 0 || mx > 6 || my < 0 || my > 6) {
+          continue;
+        }
+
+        const bool ring = mx == 0 || mx == 6 || my == 0 || my == 6;
+        const bool middle = mx >= 2 && mx <= 4 && my >= 2 && my <= 4;
+        if (ring || middle) {
+          image->at<uchar>(y, x) = 0;
+        }
+      }
+    }
+  }
+}
+
+MATCHER_P(CenterNear, center, "") {
+  return std::abs(arg.center.x - center.x) <= 1 &&
+         std::abs(arg.center.y - center.y) <= 1;
+}
+
+TEST_F(LocateCodeTest, LocateCodes) {
+  cv::Mat image(800, 800, CV_8UC1, cv::Scalar(255));
+
+  // A grid of 25-module codes with 6-pixel modules, so the positioning points
+  // are 108 pixels apart, and a smaller code in the bottom right.
+  DrawCode(&image, {100, 100}, 6, 25);
+  DrawCode(&image, {400, 100}, 6, 25);
+  DrawCode(&image, {100, 400}, 6, 25);
+  DrawCode(&image, {400, 400}, 6, 25);
+  DrawCode(&image, {600, 600}, 4, 25);
+
+  // A stray positioning block.
+  DrawPositioningBlock(&image, {100, 700}, 6);
+
+  for (int num_threads : {1, 4}) {
+    LocateOptions options;
+    options.num_threads = num_threads;
+    EXPECT_THAT(LocateCodes(image, options),
+                ElementsAre(CenterNear(Point(154, 154)),
+                            CenterNear(Point(454, 154)),
+                            CenterNear(Point(154, 454)),
+                            CenterNear(Point(454, 454)),
+                            CenterNear(Point(636, 636))));
+  }
+
+  EXPECT_THAT(LocateCodes(cv::Mat(100, 100, CV_8UC1, cv::Scalar(255))),
+              ElementsAre());
+}
+
+// With large modules, rows keep adding to a cluster long after the one that
+// started it. Stopping early must wait for them, and so find what the full
+// scan does.
+TEST_F(LocateCodeTest, EarlyStopLargeModules) {
+  cv::Mat image(1600, 1600, CV_8UC1, cv::Scalar(255));
+  DrawRotatedCode(&image, {600, 350}, 60, 21, 20.0);
+
+  auto expected = LocateCode(image);
+  ASSERT_THAT(expected, VariantWith<std::unique_ptr<LocatedCode>>(_));
+
+  for (int row_step : {1, 4}) {
+    LocateStats stats;
+    LocateOptions options;
+    options.row_step = row_step;
+    options.early_stop_hits = 3;
+    options.stats = &stats;
+
+    auto result = LocateCode(image, options);
+    ASSERT_THAT(result, VariantWith<std::unique_ptr<LocatedCode>>(_));
+    EXPECT_THAT(
+        absl::get<std::unique_ptr<LocatedCode>>(result)->positioning_points,
+        Eq(absl::get<std::unique_ptr<LocatedCode>>(expected)
+               ->positioning_points))
+        << "row_step " << row_step;
+    if (row_step == 1) {
+      EXPECT_GT(stats.rows_skipped, 0);
+    }
+  }
+}
+
+TEST_F(LocateCodeTest, RunLengthImage) {
+  for (const char* path : {kStraightImageRelPath, kTiltImageRelPath}) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    ASSERT_TRUE(image.data != nullptr) << path;
+
+    auto expected = LocateCode(image);
+    ASSERT_THAT(expected, VariantWith<std::unique_ptr<LocatedCode>>(_));
+
+    std::unique_ptr<RunLengthImage> runs =
+        RunLengthImageFromGrayImage(image, true);
+    for (int num_threads : {1, 4}) {
+      LocateOptions options;
+      options.num_threads = num_threads;
+      options.run_length_image = runs.get();
+
+      auto result = LocateCode(image, options);
+      ASSERT_THAT(result, VariantWith<std::unique_ptr<LocatedCode>>(_));
+      EXPECT_THAT(
+          absl::get<std::unique_ptr<LocatedCode>>(result)->positioning_points,
+          Eq(absl::get<std::unique_ptr<LocatedCode>>(expected)
+                 ->positioning_points))
+          << path << " threads " << num_threads;
+    }
+  }
+}
+
+TEST_F(LocateCodeTest, BitImage) {
+  for (const char* path : {kStraightImageRelPath, kTiltImageRelPath}) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    ASSERT_TRUE(image.data != nullptr) << path;
+
+    auto expected = LocateCode(image);
+    ASSERT_THAT(expected, VariantWith<std::unique_ptr<LocatedCode>>(_));
+
+    std::unique_ptr<BitImage> bit_image = BitImageFromGrayImage(image, 127);
+    for (int num_threads : {1, 4}) {
+      LocateOptions options;
+      options.num_threads = num_threads;
+
+      auto result = LocateCode(*bit_image, options);
+      ASSERT_THAT(result, VariantWith<std::unique_ptr<LocatedCode>>(_));
+      EXPECT_THAT(
+          absl::get<std::unique_ptr<LocatedCode>>(result)->positioning_points,
+          Eq(absl::get<std::unique_ptr<LocatedCode>>(expected)
+                 ->positioning_points))
+          << path << " threads " << num_threads;
+    }
+  }
+}
+
+TEST_F(LocateCodeTest, LazyBinaryImage) {
+  for (const char* path : {kStraightImageRelPath, kTiltImageRelPath}) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    ASSERT_TRUE(image.data != nullptr) << path;
+
+    auto expected = LocateCode(image);
+    ASSERT_THAT(expected, VariantWith<std::unique_ptr<LocatedCode>>(_));
+
+    for (int num_threads : {1, 4}) {
+      LocateOptions options;
+      options.num_threads = num_threads;
+
+      LazyBinaryImage lazy_image(image, 127);
+      auto result = LocateCode(lazy_image, options);
+      ASSERT_THAT(result, VariantWith<std::unique_ptr<LocatedCode>>(_));
+      EXPECT_THAT(
+          absl::get<std::unique_ptr<LocatedCode>>(result)->positioning_points,
+          Eq(absl::get<std::unique_ptr<LocatedCode>>(expected)
+                 ->positioning_points))
+          << path << " threads " << num_threads;
+    }
+  }
+}
+
 }  // namespace
@@ -1,18 +1,25 @@
 #include "qrcode/qr_locate_utils.h"
 
 #include <assert.h>
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <tuple>
 #include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 
+#include "qrcode/bit_image.h"
+#include "qrcode/lazy_binary_image.h"
 #include "qrcode/pixel_iterator.h"
 #include "qrcode/qr_types.h"
+#include "qrcode/run_length_image.h"
 #include "qrcode/runner.h"
 
-bool IsPositioningBlock(const std::vector<int>& lens) {
+bool IsPositioningBlock(absl::Span<const int> lens) {
   const int lb = lens[0];
   const int lw = lens[1];
   const int c = lens[2];
@@ -38,36 +45,84 @@ bool IsPositioningBlock(const std::vector<int>& lens) {
   return true;
 }
 
-absl::optional<std::vector<Point>> ClusterPoints(const std::vector<Point>& in,
-                                                 int thresh, int max_clusters) {
-  std::vector<Point> clusters;
-  clusters.reserve(max_clusters);
+Point PointCluster::Center() const {
+  return Point((2 * sum_x + support) / (2 * support),
+               (2 * sum_y + support) / (2 * support));
+}
 
-  auto dist = [](const Point& a, const Point& b) {
-    return std::abs(a.x - b.x) + std::abs(a.y - b.y);
-  };
+PointClusterer::PointClusterer(int thresh) : thresh_(std::max(thresh, 1)) {}
 
-  for (const Point& point : in) {
-    bool found = false;
-    for (const Point& cluster : clusters) {
-      if (dist(point, cluster) <= thresh) {
-        found = true;
-        break;  // it's in an existing cluster, so discard
+int64_t PointClusterer::CellKey(int cell_x, int cell_y) const {
+  return static_cast<int64_t>(
+      (static_cast<uint64_t>(static_cast<uint32_t>(cell_x)) << 32) |
+      static_cast<uint32_t>(cell_y));
+}
+
+void PointClusterer::Add(const Point& point, int row) {
+  // A cluster that can take this point has its first point within thresh_ of
+  // it, so in this point's cell or one of the eight around it.
+  const int cell_x = point.x / thresh_;
+  const int cell_y = point.y / thresh_;
+
+  int best = -1;
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      auto iter = cells_.find(CellKey(cell_x + dx, cell_y + dy));
+      if (iter == cells_.end()) {
+        continue;
+      }
+
+      for (int index : iter->second) {
+        const Point& first = clusters_[index].first;
+        if (std::abs(point.x - first.x) + std::abs(point.y - first.y) <=
+                thresh_ &&
+            (best < 0 || index < best)) {
+          best = index;
+        }
       }
     }
+  }
+
+  if (best < 0) {
+    best = clusters_.size();
+    clusters_.push_back({point, 0, 0, 0, row});
+    cells_[CellKey(cell_x, cell_y)].push_back(best);
+  }
+
+  PointCluster& cluster = clusters_[best];
+  ++cluster.support;
+  cluster.sum_x += point.x;
+  cluster.sum_y += point.y;
+  cluster.last_row = std::max(cluster.last_row, row);
+}
 
-    if (found) {
+absl::optional<PositioningPoints> PointClusterer::FindPositioningPoints(
+    int min_support, int next_row) const {
+  std::vector<Point> centers;
+  for (const PointCluster& cluster : clusters_) {
+    if (cluster.support < min_support) {
       continue;
     }
-
-    if (clusters.size() >= max_clusters) {
-      return absl::nullopt;  // too many clusters
+    if (cluster.last_row + thresh_ >= next_row || centers.size() == 3) {
+      return absl::nullopt;
     }
+    centers.push_back(cluster.Center());
+  }
 
-    clusters.push_back(point);
+  if (centers.size() != 3) {
+    return absl::nullopt;
   }
 
-  return clusters;
+  return OrderPositioningPoints(centers[0], centers[1], centers[2]);
+}
+
+std::vector<PointCluster> ClusterPoints(const std::vector<Point>& in,
+                                        int thresh) {
+  PointClusterer clusterer(thresh);
+  for (const Point& point : in) {
+    clusterer.Add(point);
+  }
+  return clusterer.clusters();
 }
 
 namespace {
@@ -146,15 +201,203 @@ double CalculateCodeRotationAngle(const PositioningPoints& points) {
   return std::atan(run / rise) / (2 * M_PI) * 360.0;
 }
 
-std::vector<Point> FindPositioningPointCandidatesInRow(
-    PixelIterator<const unsigned char>* image_iter, int row) {
+std::vector<PositioningPoints> GroupPositioningPoints(
+    const std::vector<PointCluster>& clusters) {
+  // Clusters with less support than this are noise. Even a code with
+  // one-pixel modules has a positioning point center three rows tall.
+  constexpr int kMinSupport = 2;
+  // Clusters whose supports differ by more than this factor come from blocks
+  // of different sizes.
+  constexpr int kMaxSupportRatio = 2;
+  // The longer side of a code may be at most this much longer than the
+  // shorter, which leaves room for some perspective.
+  constexpr double kMaxSideRatio = 1.4;
+  // Positioning points are at least 14 modules apart (version 1), while a
+  // cluster's support is roughly the height of the block's 3-module center,
+  // or a little more if the code is rotated. Sides shorter than this many
+  // supports can't be real.
+  constexpr double kMinSideToSupport = 2.0;
+  // Positioning points are at most 170 modules apart (version 40), and a
+  // cluster's support is at least about two modules, even when the code is
+  // rotated. Allowing for perspective, sides longer than this many supports
+  // can't be real.
+  constexpr double kMaxSideToSupport = 120.0;
+  // The diagonal of a code is at most this many times its longer side.
+  constexpr double kMaxDiagonalToSide = 1.5;
+
+  struct Group {
+    double side;
+    std::array<int, 3> indexes;
+    PositioningPoints points;
+  };
+
+  std::vector<Point> centers;
+  centers.reserve(clusters.size());
+  std::vector<int> order;
+  for (int i = 0; i < clusters.size(); ++i) {
+    centers.push_back(clusters[i].Center());
+    if (clusters[i].support >= kMinSupport) {
+      order.push_back(i);
+    }
+  }
+
+  // Any two points of a code are closer than its diagonal, which bounds how
+  // far apart in x two clusters of a group can be.
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) { return centers[a].x < centers[b].x; });
+  auto reach = [&](int a) {
+    return kMaxDiagonalToSide * kMaxSideToSupport * clusters[a].support;
+  };
+
+  auto distance = [](const Point& a, const Point& b) {
+    return std::hypot(a.x - b.x, a.y - b.y);
+  };
+
+  auto can_pair = [&](int a, int b) {
+    const int lo = std::min(clusters[a].support, clusters[b].support);
+    const int hi = std::max(clusters[a].support, clusters[b].support);
+    return hi <= kMaxSupportRatio * lo &&
+           distance(centers[a], centers[b]) <= std::min(reach(a), reach(b));
+  };
+
+  std::vector<Group> groups;
+  for (int oi = 0; oi < order.size(); ++oi) {
+    const int i = order[oi];
+    const double max_x = centers[i].x + reach(i);
+    for (int oj = oi + 1; oj < order.size() && centers[order[oj]].x <= max_x;
+         ++oj) {
+      const int j = order[oj];
+      if (!can_pair(i, j)) {
+        continue;
+      }
+
+      for (int ok = oj + 1;
+           ok < order.size() && centers[order[ok]].x <= max_x; ++ok) {
+        const int k = order[ok];
+        if (!can_pair(i, k) || !can_pair(j, k)) {
+          continue;
+        }
+
+        absl::optional<PositioningPoints> maybe_points =
+            OrderPositioningPoints(centers[i], centers[j], centers[k]);
+        if (!maybe_points.has_value()) {
+          continue;
+        }
+
+        const PositioningPoints& points = maybe_points.value();
+        const double top = distance(points.top_left, points.top_right);
+        const double left = distance(points.top_left, points.bottom_left);
+        const double short_side = std::min(top, left);
+        const double long_side = std::max(top, left);
+        const int min_support = std::min(
+            {clusters[i].support, clusters[j].support, clusters[k].support});
+        const int max_support = std::max(
+            {clusters[i].support, clusters[j].support, clusters[k].support});
+        if (long_side > kMaxSideRatio * short_side ||
+            short_side < kMinSideToSupport * max_support ||
+            long_side > kMaxSideToSupport * min_support) {
+          continue;
+        }
+
+        std::array<int, 3> indexes = {i, j, k};
+        std::sort(indexes.begin(), indexes.end());
+        groups.push_back({long_side, indexes, points});
+      }
+    }
+  }
+
+  // Ties go to the group whose clusters were started first.
+  std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+    return std::tie(a.side, a.indexes) < std::tie(b.side, b.indexes);
+  });
+
+  std::vector<char> used(clusters.size(), false);
+  std::vector<const Group*> chosen;
+  for (const Group& group : groups) {
+    if (used[group.indexes[0]] || used[group.indexes[1]] ||
+        used[group.indexes[2]]) {
+      continue;
+    }
+
+    for (int index : group.indexes) {
+      used[index] = true;
+    }
+    chosen.push_back(&group);
+  }
+
+  std::sort(chosen.begin(), chosen.end(), [](const Group* a, const Group* b) {
+    return a->indexes[0] < b->indexes[0];
+  });
+
+  std::vector<PositioningPoints> result;
+  for (const Group* group : chosen) {
+    result.push_back(group->points);
+  }
+  return result;
+}
+
+namespace {
+
+// {row, center_x} is in the middle of a run of black, in the middle of a series
+// of runs that's compatible with the ratios for a positioning block. If we're
+// truly in the middle of a positioning block, we can confirm that by looking
+// for a series of runs that are compatible with a positioning block on a
+// vertical line that runs through {row, center_x}.
+//
+// Because we know it has to go through {row, center_x}, we can start from that
+// point, looking for black-white-black in either direction. In both cases we'll
+// be looking *out*, and starting from black, so the first black runs we find
+// are actually part of the same run. Join the two together and we can check
+// for positioning ratios.
+//
+// A picture, rotated 90 degrees:
+//
+//     (up)      aaaaa     bbbb+bbbbbbbbbb     ccccc      (down)
+//
+// The horizontal line search got us to +, which is {row, center_x}. Our search
+// up from + finds black run B, then a white run, then black run A. Our search
+// down from + finds the rest of black run B, then a white run, then black run
+// C. Before we check for positioning block ratios we need to combine the
+// results of both searches so we have lengths for black run A, the white run,
+// black run B (which is the sum of the black run Bs from the two searches), the
+// other white run, and black run C. We therefore do a ratio check on this:
+//
+//     (up)      aaaaa     bbbbbbbbbbbbbbb     ccccc      (down)
+//
+// If the ratio check succeeds, this function returns center_y, which is in the
+// middle of run B (and may not be the same as the location of +).
+absl::optional<int> FindVerticalCenter(int row, absl::Span<const int> three_up,
+                                       absl::Span<const int> three_down) {
+  const int center_height = three_up[0] + three_down[0];
+
+  const std::array<int, 5> combined = {
+      three_up[2],    // top black height
+      three_up[1],    // top white height
+      center_height,  // center height
+      three_down[1],  // bottom white height
+      three_down[2],  // bottow black height
+  };
+
+  if (!IsPositioningBlock(combined)) {
+    return absl::nullopt;
+  }
+
+  return row - three_up[0] + center_height / 2;
+}
+
+// Implements FindPositioningPointCandidatesInRow for any pixel iterator that
+// makes DirectionalIterators usable with FixedRunner.
+template <class PixelIter>
+std::vector<Point> FindCandidatesInRow(PixelIter* image_iter, int row) {
+  using Directional = decltype(image_iter->MakeForwardColumnIterator());
+
   image_iter->Seek(0, row);
 
   // If the row starts with white we need to skip the first set of
   // values returned by the runner.
   bool skip_first = image_iter->Get() != 0;
 
-  Runner runner(image_iter->MakeForwardColumnIterator());
+  FixedRunner<5, Directional> runner(image_iter->MakeForwardColumnIterator());
   std::vector<Point> candidates;
 
   if (skip_first) {
@@ -168,7 +411,7 @@ std::vector<Point> FindPositioningPointCandidatesInRow(
       return candidates;
     }
 
-    const std::vector<int> lens = std::move(result.value());
+    const absl::Span<const int> lens = *result;
     if (IsPositioningBlock(lens)) {
       const int left_black_width = lens[0];
       const int left_white_width = lens[1];
@@ -179,60 +422,21 @@ std::vector<Point> FindPositioningPointCandidatesInRow(
 
       image_iter->Seek(center_x, row);
 
-      // {row, center_x} is in the middle of a run of black, in the middle of a
-      // series of runs that's compatible with the ratios for a positioning
-      // block. If we're truly in the middle of a positioning block, we can
-      // confirm that by looking for a series of runs that are compatible with a
-      // positioning block on a vertical line that runs through {row, center_x}.
-      //
-      // Because we know it has to go through {row, center_x}, we can start from
-      // that point, looking for black-white-black in either direction. In both
-      // cases we'll be looking *out*, and starting from black, so the first
-      // black runs we find are actually part of the same run. Join the two
-      // together and we can check for positioning ratios.
-      //
-      // A picture, rotated 90 degrees:
-      //
-      //     (up)      aaaaa     bbbb+bbbbbbbbbb     ccccc      (down)
-      //
-      // The horizontal line search got us to +, which is {row, center_x}. Our
-      // search up from + finds black run B, then a white run, then black run
-      // A. Our search down from + finds the rest of black run B, then a white
-      // run, then black run C. Before we check for positioning block ratios we
-      // need to combine the results of both searches so we have lengths for
-      // black run A, the white run, black run B (which is the sum of the black
-      // run Bs from the two searches), the other white run, and black run C. We
-      // therefore do a ratio check on this:
-      //
-      //     (up)      aaaaa     bbbbbbbbbbbbbbb     ccccc      (down)
-      //
-      // If the ratio check succeeds, center_y is in the middle of run B (which
-      // may not be the same as the location of +).
-      auto get_three = [](DirectionalIterator<const unsigned char> iter) {
-        return Runner(iter).Next(3, nullptr);
-      };
-
-      absl::optional<std::vector<int>> maybe_three_up =
-          get_three(image_iter->MakeReverseRowIterator());
-      absl::optional<std::vector<int>> maybe_three_down =
-          get_three(image_iter->MakeForwardRowIterator());
+      FixedRunner<3, Directional> up_runner(
+          image_iter->MakeReverseRowIterator());
+      FixedRunner<3, Directional> down_runner(
+          image_iter->MakeForwardRowIterator());
+
+      absl::optional<absl::Span<const int>> maybe_three_up =
+          up_runner.Next(3, nullptr);
+      absl::optional<absl::Span<const int>> maybe_three_down =
+          down_runner.Next(3, nullptr);
 
       if (maybe_three_up.has_value() && maybe_three_down.has_value()) {
-        const std::vector<int> three_up = std::move(maybe_three_up.value());
-        const std::vector<int> three_down = std::move(maybe_three_down.value());
-        const int center_height = three_up[0] + three_down[0];
-
-        std::vector<int> combined = {
-            three_up[2],    // top black height
-            three_up[1],    // top white height
-            center_height,  // center height
-            three_down[1],  // bottom white height
-            three_down[2],  // bottow black height
-        };
-
-        if (IsPositioningBlock(combined)) {
-          const int center_y = row - three_up[0] + center_height / 2;
-          candidates.emplace_back(center_x, center_y);
+        absl::optional<int> center_y =
+            FindVerticalCenter(row, *maybe_three_up, *maybe_three_down);
+        if (center_y.has_value()) {
+          candidates.emplace_back(center_x, *center_y);
         }
       }
     }
@@ -241,3 +445,62 @@ std::vector<Point> FindPositioningPointCandidatesInRow(
     runner.Next(1, nullptr);
   }
 }
+
+}  // namespace
+
+std::vector<Point> FindPositioningPointCandidatesInRow(
+    PixelIterator<const unsigned char>* image_iter, int row) {
+  return FindCandidatesInRow(image_iter, row);
+}
+
+std::vector<Point> FindPositioningPointCandidatesInRow(
+    BitPixelIterator* image_iter, int row) {
+  return FindCandidatesInRow(image_iter, row);
+}
+
+std::vector<Point> FindPositioningPointCandidatesInRow(
+    LazyPixelIterator* image_iter, int row) {
+  return FindCandidatesInRow(image_iter, row);
+}
+
+std::vector<Point> FindPositioningPointCandidatesInRow(
+    const RunLengthImage& image, int row) {
+  absl::Span<const int> starts = image.RowRunStarts(row);
+  const int num_runs = starts.size();
+  auto run_len = [&](int i) {
+    return (i + 1 < num_runs ? starts[i + 1] : image.width()) - starts[i];
+  };
+
+  std::vector<Point> candidates;
+
+  // Look at the same groups of runs as the PixelIterator version: groups of
+  // five starting with black, advancing by two runs each time.
+  std::array<int, 5> lens;
+  for (int i = image.RowStartsNonZero(row) ? 1 : 0; i + 5 <= num_runs;
+       i += 2) {
+    for (int j = 0; j < lens.size(); ++j) {
+      lens[j] = run_len(i + j);
+    }
+
+    if (!IsPositioningBlock(lens)) {
+      continue;
+    }
+
+    const int center_x = starts[i + 2] + lens[2] / 2;
+    const Point center(center_x, row);
+
+    std::array<int, 3> three_up, three_down;
+    if (!image.Runs(center, 0, -1, absl::MakeSpan(three_up)) ||
+        !image.Runs(center, 0, 1, absl::MakeSpan(three_down))) {
+      continue;
+    }
+
+    absl::optional<int> center_y =
+        FindVerticalCenter(row, three_up, three_down);
+    if (center_y.has_value()) {
+      candidates.emplace_back(center_x, *center_y);
+    }
+  }
+
+  return candidates;
+}
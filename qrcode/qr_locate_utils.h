@@ -1,26 +1,103 @@
 #ifndef _QRCODE_QR_LOCATE_UTILS_H_
 #define _QRCODE_QR_LOCATE_UTILS_H_ 1
 
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 
+#include "qrcode/bit_image.h"
+#include "qrcode/lazy_binary_image.h"
 #include "qrcode/pixel_iterator.h"
 #include "qrcode/point.h"
 #include "qrcode/qr_types.h"
+#include "qrcode/run_length_image.h"
 
-bool IsPositioningBlock(const std::vector<int>& lens);
+bool IsPositioningBlock(absl::Span<const int> lens);
 
 std::vector<Point> FindPositioningPointCandidatesInRow(
     PixelIterator<const unsigned char>* image_iter, int row);
 
-// Cluster the set of input points. thresh is the maximum Manhattan
-// distance allowed between the first point in a cluster and any
-// subsequent point. max_clusters is the maximum number of clusters
-// allowed. If the number of clusters founds exceeds this number the
-// function will return early.
-absl::optional<std::vector<Point>> ClusterPoints(const std::vector<Point>& in,
-                                                 int thresh, int max_clusters);
+// As above, for a bit-packed image.
+std::vector<Point> FindPositioningPointCandidatesInRow(
+    BitPixelIterator* image_iter, int row);
+
+// As above, for a lazily thresholded image.
+std::vector<Point> FindPositioningPointCandidatesInRow(
+    LazyPixelIterator* image_iter, int row);
+
+// As above, but reads the row and the vertical checks from pre-computed runs,
+// which must include column tables. Returns the same candidates.
+std::vector<Point> FindPositioningPointCandidatesInRow(
+    const RunLengthImage& image, int row);
+
+// A group of points that lie close together.
+struct PointCluster {
+  // The mean of the points in the cluster, rounded to the nearest pixel.
+  Point Center() const;
+
+  // The first point added to the cluster. Every other point in the cluster is
+  // within the clustering threshold of it.
+  Point first;
+
+  // The number of points in the cluster.
+  int support;
+
+  // The sums of the coordinates of the points in the cluster.
+  long sum_x, sum_y;
+
+  // The last row a point in the cluster was found on.
+  int last_row;
+};
+
+// Clusters points one at a time. Each point joins the oldest cluster whose
+// first point is within thresh (Manhattan distance) of it, or starts a new
+// cluster if there is none. Clusters are indexed by a grid of thresh-sized
+// cells, so adding a point takes constant time however many clusters there
+// are.
+class PointClusterer {
+ public:
+  explicit PointClusterer(int thresh);
+  ~PointClusterer() = default;
+
+  PointClusterer(const PointClusterer&) = delete;
+
+  // Adds a point found on the given row.
+  void Add(const Point& point, int row);
+
+  // As above, for a point found on row point.y.
+  void Add(const Point& point) { Add(point, point.y); }
+
+  // Returns the clusters in the order they were started.
+  const std::vector<PointCluster>& clusters() const { return clusters_; }
+
+  // Looks for a settled set of positioning points, given that points are
+  // being added in row order and every row before next_row has been added.
+  // Succeeds if exactly three clusters have at least min_support points, none
+  // of those can grow any more, and OrderPositioningPoints accepts their
+  // centers. A cluster takes a point from each row that crosses its block's
+  // center, however far that row is from the cluster's first point, so a
+  // cluster is taken to be done growing once thresh rows have gone by without
+  // adding to it.
+  absl::optional<PositioningPoints> FindPositioningPoints(int min_support,
+                                                          int next_row) const;
+
+ private:
+  int64_t CellKey(int cell_x, int cell_y) const;
+
+  const int thresh_;
+  std::vector<PointCluster> clusters_;
+
+  // Maps each grid cell to the clusters whose first points are in it.
+  std::unordered_map<int64_t, std::vector<int>> cells_;
+};
+
+// Clusters the input points as PointClusterer does, returning the clusters in
+// the order they were started.
+std::vector<PointCluster> ClusterPoints(const std::vector<Point>& in,
+                                        int thresh);
 
 // Orders three points such that points 1 and 2 form a line that is
 // perpendicular to the line formed by points 2 and 3.
@@ -28,6 +105,18 @@ absl::optional<PositioningPoints> OrderPositioningPoints(const Point& a,
                                                          const Point& b,
                                                          const Point& c);
 
+// Groups clusters of positioning point candidates into the positioning points
+// of as many codes as possible. Clusters with too little support to be
+// positioning points are ignored. Three clusters can form a code if
+// OrderPositioningPoints accepts their centers, the code's two sides are about
+// the same length, the clusters have similar support (positioning blocks of
+// the same size), and the sides are neither too short nor too long for blocks
+// of that size. Each cluster is used at most once, with smaller codes claiming
+// clusters first so that neighboring codes aren't mistaken for one big one.
+// Codes are returned in the order of their first-started clusters.
+std::vector<PositioningPoints> GroupPositioningPoints(
+    const std::vector<PointCluster>& clusters);
+
 // Calculate the angle of rotation of the code relative to upright.
 double CalculateCodeRotationAngle(const PositioningPoints& points);
 
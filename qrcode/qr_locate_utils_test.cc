@@ -46,6 +46,10 @@ TEST(IsPositioningBlockTest, Test) {
   }
 }
 
+MATCHER_P2(ClusterIs, center, support, "") {
+  return arg.Center() == center && arg.support == support;
+}
+
 TEST(ClusterPointsTest, Simple) {
   static std::vector<Point> kPoints = {{10, 10},  //
                                        {11, 11},  // 2 away from 10, 10
@@ -53,13 +57,10 @@ TEST(ClusterPointsTest, Simple) {
                                        {20, 20},  //
                                        {30, 30}};
 
-  // Just right
-  EXPECT_THAT(
-      ClusterPoints(kPoints, 5, 99),
-      Optional(ElementsAre(Point(10, 10), Point(20, 20), Point(30, 30))));
-
-  // Too many clusters
-  EXPECT_THAT(ClusterPoints(kPoints, 5, 2), Eq(absl::nullopt));
+  EXPECT_THAT(ClusterPoints(kPoints, 5),
+              ElementsAre(ClusterIs(Point(11, 11), 3),
+                          ClusterIs(Point(20, 20), 1),
+                          ClusterIs(Point(30, 30), 1)));
 }
 
 TEST(ClusterPointsTest, Large) {
@@ -78,9 +79,147 @@ TEST(ClusterPointsTest, Large) {
       {1062, 1592}, {1061, 1592}, {1060, 1591}, {1060, 1591}, {1059, 1590},
       {1058, 1590}, {1058, 1590}, {1058, 1590}};
 
-  EXPECT_THAT(ClusterPoints(kPoints, 50, 3),
-              Optional(ElementsAre(Point(1582, 909), Point(2271, 1410),
-                                   Point(1072, 1598))));
+  std::vector<PointCluster> clusters = ClusterPoints(kPoints, 50);
+  ASSERT_EQ(3, clusters.size());
+  EXPECT_THAT(clusters[0].first, Eq(Point(1582, 909)));
+  EXPECT_THAT(clusters[1].first, Eq(Point(2271, 1410)));
+  EXPECT_THAT(clusters[2].first, Eq(Point(1072, 1598)));
+  EXPECT_THAT(clusters, ElementsAre(ClusterIs(Point(1576, 904), 22),
+                                    ClusterIs(Point(2265, 1406), 20),
+                                    ClusterIs(Point(1064, 1594), 21)));
+}
+
+// Points must join the oldest cluster in range, as they would if every
+// cluster were checked in turn, even when clusters sit in different cells.
+TEST(ClusterPointsTest, OldestClusterWins) {
+  static std::vector<Point> kPoints = {{26, 10}, {19, 10}, {22, 10}};
+
+  EXPECT_THAT(ClusterPoints(kPoints, 5),
+              ElementsAre(ClusterIs(Point(24, 10), 2),  //
+                          ClusterIs(Point(19, 10), 1)));
+}
+
+// There's no cap on the number of clusters.
+TEST(ClusterPointsTest, ManyClusters) {
+  std::vector<Point> points;
+  for (int y = 0; y < 100; ++y) {
+    for (int x = 0; x < 100; ++x) {
+      points.emplace_back(x * 20, y * 20);
+      points.emplace_back(x * 20 + 1, y * 20 + 1);
+    }
+  }
+
+  std::vector<PointCluster> clusters = ClusterPoints(points, 5);
+  ASSERT_EQ(10000, clusters.size());
+  for (int i = 0; i < clusters.size(); ++i) {
+    EXPECT_EQ(2, clusters[i].support) << i;
+    EXPECT_EQ(points[2 * i], clusters[i].first) << i;
+  }
+}
+
+TEST(PointClustererTest, FindPositioningPoints) {
+  PointClusterer clusterer(5);
+  for (const Point& point : std::vector<Point>{
+           {50, 50}, {51, 51}, {100, 50}, {49, 52}, {100, 52}, {50, 100}}) {
+    clusterer.Add(point);
+  }
+
+  EXPECT_THAT(clusterer.FindPositioningPoints(1, 200),
+              Optional(MakePositioningPoints({50, 51}, {100, 51}, {50, 100})));
+
+  // Not enough support in the third cluster.
+  EXPECT_THAT(clusterer.FindPositioningPoints(2, 200), Eq(absl::nullopt));
+
+  // The third cluster could still grow.
+  EXPECT_THAT(clusterer.FindPositioningPoints(1, 105), Eq(absl::nullopt));
+  EXPECT_THAT(clusterer.FindPositioningPoints(1, 106),
+              Optional(MakePositioningPoints({50, 51}, {100, 51}, {50, 100})));
+
+  // Too many clusters with enough support.
+  clusterer.Add({200, 200});
+  EXPECT_THAT(clusterer.FindPositioningPoints(1, 300), Eq(absl::nullopt));
+  EXPECT_THAT(clusterer.FindPositioningPoints(2, 300), Eq(absl::nullopt));
+}
+
+// Every row that crosses a block's center finds the block's center, so rows
+// far below a cluster's first point can still add to it.
+TEST(PointClustererTest, WaitsForLastRow) {
+  PointClusterer clusterer(5);
+  for (int row = 40; row <= 60; ++row) {
+    clusterer.Add({50, 50}, row);
+    clusterer.Add({100, 50}, row);
+  }
+  for (int row = 90; row <= 110; ++row) {
+    clusterer.Add({50, 100}, row);
+  }
+
+  EXPECT_THAT(clusterer.FindPositioningPoints(1, 115), Eq(absl::nullopt));
+  EXPECT_THAT(clusterer.FindPositioningPoints(1, 116),
+              Optional(MakePositioningPoints({50, 50}, {100, 50}, {50, 100})));
+}
+
+TEST(PointClustererTest, NotPerpendicular) {
+  PointClusterer clusterer(5);
+  clusterer.Add({50, 50});
+  clusterer.Add({100, 50});
+  clusterer.Add({150, 50});
+
+  EXPECT_THAT(clusterer.FindPositioningPoints(1, 100), Eq(absl::nullopt));
+}
+
+PointCluster MakeCluster(const Point& center, int support) {
+  return {center, support, static_cast<long>(center.x) * support,
+          static_cast<long>(center.y) * support, center.y};
+}
+
+TEST(GroupPositioningPointsTest, Test) {
+  // Four codes, with sides of 100, laid out on a grid with a pitch of 300.
+  // The top left points of the codes also form a (bigger) code.
+  std::vector<PointCluster> clusters;
+  for (const Point& origin : std::vector<Point>{
+           {100, 100}, {400, 100}, {100, 400}, {400, 400}}) {
+    clusters.push_back(MakeCluster(origin, 20));
+    clusters.push_back(MakeCluster({origin.x + 100, origin.y}, 20));
+    clusters.push_back(MakeCluster({origin.x, origin.y + 100}, 20));
+  }
+
+  // A stray cluster that would complete a code if its support matched.
+  clusters.push_back(MakeCluster({700, 100}, 20));
+  clusters.push_back(MakeCluster({800, 100}, 20));
+  clusters.push_back(MakeCluster({700, 200}, 2));
+
+  EXPECT_THAT(
+      GroupPositioningPoints(clusters),
+      ElementsAre(MakePositioningPoints({100, 100}, {200, 100}, {100, 200}),
+                  MakePositioningPoints({400, 100}, {500, 100}, {400, 200}),
+                  MakePositioningPoints({100, 400}, {200, 400}, {100, 500}),
+                  MakePositioningPoints({400, 400}, {500, 400}, {400, 500})));
+}
+
+TEST(GroupPositioningPointsTest, Rejects) {
+  // Sides too different.
+  EXPECT_THAT(GroupPositioningPoints({MakeCluster({100, 100}, 10),
+                                      MakeCluster({300, 100}, 10),
+                                      MakeCluster({100, 200}, 10)}),
+              ElementsAre());
+
+  // Sides too short for the size of the blocks.
+  EXPECT_THAT(GroupPositioningPoints({MakeCluster({100, 100}, 40),
+                                      MakeCluster({150, 100}, 40),
+                                      MakeCluster({100, 150}, 40)}),
+              ElementsAre());
+
+  // Sides too long for the size of the blocks.
+  EXPECT_THAT(GroupPositioningPoints({MakeCluster({100, 100}, 2),
+                                      MakeCluster({400, 100}, 2),
+                                      MakeCluster({100, 400}, 2)}),
+              ElementsAre());
+
+  // Single hits are noise.
+  EXPECT_THAT(GroupPositioningPoints({MakeCluster({100, 100}, 1),
+                                      MakeCluster({150, 100}, 1),
+                                      MakeCluster({100, 150}, 1)}),
+              ElementsAre());
 }
 
 class OrderPositioningPointsTest : public ::testing::Test {
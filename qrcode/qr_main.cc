@@ -9,17 +9,42 @@
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/opencv.hpp"
 
+#include "qrcode/binarizer.h"
+#include "qrcode/bit_image.h"
 #include "qrcode/cv_utils.h"
 #include "qrcode/debug_image.h"
+#include "qrcode/lazy_binary_image.h"
 #include "qrcode/point.h"
 #include "qrcode/qr_locate.h"
 #include "qrcode/qr_normalize.h"
+#include "qrcode/run_length_image.h"
 #include "qrcode/qr_types.h"
 #include "qrcode/runner.h"
 
 ABSL_FLAG(std::string, input, "", "Input file");
 ABSL_FLAG(bool, display, false, "Display the B&W image");
 ABSL_FLAG(int, row, -1, "Use this row only for the first scan");
+ABSL_FLAG(int, reduction, 1,
+          "Read the image at 1/reduction scale; must be 1, 2, 4, or 8");
+ABSL_FLAG(std::string, binarizer, "global",
+          "How to binarize the image: global or local");
+ABSL_FLAG(int, binarize_threads, 1,
+          "Number of threads used by binarizers that support them");
+ABSL_FLAG(int, locate_threads, 1,
+          "Number of threads used to search for positioning points");
+ABSL_FLAG(int, locate_row_step, 1,
+          "Scan every Nth row for positioning points, then refine around "
+          "what that finds");
+ABSL_FLAG(int, locate_early_stop_hits, 0,
+          "If positive, stop searching for positioning points once three "
+          "have this many hits each");
+ABSL_FLAG(bool, locate_run_length, false,
+          "Search for positioning points in a run-length encoded copy of the "
+          "image");
+ABSL_FLAG(bool, locate_bit_image, false,
+          "Search for positioning points in a bit-packed copy of the image");
+ABSL_FLAG(bool, lazy_binarize, false,
+          "Threshold only the parts of the image that the locator reads");
 
 int main(int argc, char** argv) {
   absl::ParseCommandLine(argc, argv);
@@ -29,15 +54,77 @@ int main(int argc, char** argv) {
     return -1;
   }
 
+  std::unique_ptr<Binarizer> binarizer =
+      MakeBinarizer(absl::GetFlag(FLAGS_binarizer),
+                    absl::GetFlag(FLAGS_binarize_threads));
+  if (binarizer == nullptr) {
+    std::cerr << "unknown binarizer " << absl::GetFlag(FLAGS_binarizer)
+              << "\n";
+    return -1;
+  }
+
+  // The lazy and bit image paths threshold the gray image as they read it,
+  // so the full thresholded image is never built. They hand the gray image
+  // itself to NormalizeCode, which thresholds what it keeps.
+  const bool lazy = absl::GetFlag(FLAGS_lazy_binarize);
+  const bool locate_bits = absl::GetFlag(FLAGS_locate_bit_image);
+  const bool from_gray = lazy || locate_bits;
+  if (from_gray && (absl::GetFlag(FLAGS_binarizer) != "global" ||
+                    absl::GetFlag(FLAGS_locate_run_length))) {
+    std::cerr << "--lazy_binarize and --locate_bit_image require "
+                 "--binarizer=global, and can't be used with "
+                 "--locate_run_length\n";
+    return -1;
+  }
+  if (lazy && locate_bits) {
+    std::cerr << "--lazy_binarize and --locate_bit_image can't be used "
+                 "together\n";
+    return -1;
+  }
+
   cv::Mat image;
-  if (!ReadBwImage(absl::GetFlag(FLAGS_input), image)) {
+  const bool read_ok =
+      from_gray ? ReadGrayImage(absl::GetFlag(FLAGS_input),
+                                absl::GetFlag(FLAGS_reduction), image)
+                : ReadBwImage(absl::GetFlag(FLAGS_input),
+                              absl::GetFlag(FLAGS_reduction), *binarizer,
+                              image);
+  if (!read_ok) {
     std::cerr << "failed to read image\n";
     return -1;
   }
 
   std::unique_ptr<DebugImage> debug_image = DebugImage::FromGray(image);
 
-  auto maybe_located_code = LocateCode(image);
+  std::unique_ptr<RunLengthImage> run_length_image;
+  if (absl::GetFlag(FLAGS_locate_run_length)) {
+    run_length_image = RunLengthImageFromGrayImage(image, true);
+  }
+
+  std::unique_ptr<BitImage> bit_image;
+  if (locate_bits) {
+    bit_image = BitImageFromGrayImage(image, 127);
+  }
+
+  std::unique_ptr<LazyBinaryImage> lazy_image;
+  if (lazy) {
+    lazy_image = absl::make_unique<LazyBinaryImage>(image, 127);
+  }
+
+  LocateOptions locate_options;
+  locate_options.num_threads = absl::GetFlag(FLAGS_locate_threads);
+  locate_options.row_step = absl::GetFlag(FLAGS_locate_row_step);
+  locate_options.early_stop_hits = absl::GetFlag(FLAGS_locate_early_stop_hits);
+  locate_options.run_length_image = run_length_image.get();
+
+  absl::variant<std::unique_ptr<LocatedCode>, std::string> maybe_located_code;
+  if (bit_image != nullptr) {
+    maybe_located_code = LocateCode(*bit_image, locate_options);
+  } else if (lazy_image != nullptr) {
+    maybe_located_code = LocateCode(*lazy_image, locate_options);
+  } else {
+    maybe_located_code = LocateCode(image, locate_options);
+  }
   if (absl::holds_alternative<std::string>(maybe_located_code)) {
     std::cerr << "failed to locate code: "
               << absl::get<std::string>(maybe_located_code);
@@ -1,54 +1,143 @@
 #include "qrcode/qr_normalize.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "absl/memory/memory.h"
 #include "absl/types/optional.h"
 
+#include "qrcode/binarizer.h"
 #include "qrcode/pixel_iterator.h"
 #include "qrcode/qr_normalize_utils.h"
 #include "qrcode/qr_utils.h"
 #include "qrcode/runner.h"
 
 absl::variant<std::unique_ptr<QRImage>, std::string> NormalizeCode(
-    cv::Mat image, const LocatedCode& located_code) {
-  cv::Mat rotation_matrix = cv::getRotationMatrix2D(
-      cv::Point2f(located_code.center.x, located_code.center.y),
-      -located_code.rotation_angle, 1.0);
-
+    cv::Mat image, const LocatedCode& located_code,
+    const NormalizeOptions& options) {
   cv::Mat rotated_image;
-  cv::warpAffine(image, rotated_image, rotation_matrix,
-                 {image.cols, image.rows});
-
-  // Rotation introduces gray, so we have to threshold again.
-  // NOTE: This needs to use the same threshold as the threshold() call in
-  // qr_main.cc, which is awkward.
-  cv::threshold(rotated_image, rotated_image, 127, 255, cv::THRESH_BINARY);
+  return NormalizeCode(image, located_code, options, &rotated_image);
+}
 
-  PixelIterator<const unsigned char> iter =
-      PixelIteratorFromGrayImage(rotated_image);
+namespace {
 
-  // The positioning points in located_code are pre-rotation. First we transform
-  // them using the rotation matrix so we know where they are post-rotation.
-  // We'll end up with points in the center positioning point box, but they
-  // might be off-center due to translation error or (more likely) difficulties
-  // detecting centers pre-rotation. Recenter the points by looking at their
-  // positions in the positioning point boxes.
+Point TransformPoint(const Point& point, const cv::Mat& matrix) {
+  std::vector<cv::Point2d> vec = {cv::Point2d(point.x, point.y)};
+  cv::transform(vec, vec, matrix);
+  return Point(vec[0].x, vec[0].y);
+}
 
+// The positioning points in located_code are pre-rotation. First we transform
+// them using the rotation matrix so we know where they are post-rotation.
+// We'll end up with points in the center positioning point box, but they
+// might be off-center due to translation error or (more likely) difficulties
+// detecting centers pre-rotation. Recenter the points by looking at their
+// positions in the positioning point boxes, which iter reads post-rotation.
+template <class PixelIter>
+PositioningPoints NormalizePositioningPoints(const LocatedCode& located_code,
+                                             const cv::Mat& rotation_matrix,
+                                             PixelIter iter) {
   auto update_point = [&](const Point& point) {
-    std::vector<cv::Point2d> vec = {cv::Point2d(point.x, point.y)};
-    cv::transform(vec, vec, rotation_matrix);
-    Point transformed_point(vec[0].x, vec[0].y);
-    return RecenterPositioningPoint(transformed_point, iter);
+    return RecenterPositioningPoint(TransformPoint(point, rotation_matrix),
+                                    iter);
   };
 
   PositioningPoints points = located_code.positioning_points;
   points.top_left = update_point(points.top_left);
   points.top_right = update_point(points.top_right);
   points.bottom_left = update_point(points.bottom_left);
+  return points;
+}
+
+// Returns the region of a size-sized straightened image that holds the code
+// with the given (straightened) positioning points, and its quiet zone.
+cv::Rect CodeRegion(const PositioningPoints& points, const cv::Size& size) {
+  // The positioning points are 3.5 modules in from the corners of the code,
+  // the quiet zone is another 4, and we allow one more for error in the
+  // points. Codes are at least 21 modules across, so their positioning points
+  // are at least 14 modules apart, which bounds the module size.
+  constexpr double kMarginModules = 3.5 + 4 + 1;
+  constexpr double kMinPointDistanceModules = 14;
+
+  const Point& tl = points.top_left;
+  const Point& tr = points.top_right;
+  const Point& bl = points.bottom_left;
+  const Point br(tr.x + bl.x - tl.x, tr.y + bl.y - tl.y);
+
+  const double side = std::max(std::hypot(tr.x - tl.x, tr.y - tl.y),
+                               std::hypot(bl.x - tl.x, bl.y - tl.y));
+  const int margin =
+      std::ceil(side * kMarginModules / kMinPointDistanceModules);
+
+  const int min_x = std::min({tl.x, tr.x, bl.x, br.x}) - margin;
+  const int max_x = std::max({tl.x, tr.x, bl.x, br.x}) + margin;
+  const int min_y = std::min({tl.y, tr.y, bl.y, br.y}) - margin;
+  const int max_y = std::max({tl.y, tr.y, bl.y, br.y}) + margin;
+
+  return cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1) &
+         cv::Rect(0, 0, size.width, size.height);
+}
+
+}  // namespace
+
+cv::Mat NormalizationMatrix(const LocatedCode& located_code) {
+  return cv::getRotationMatrix2D(
+      cv::Point2f(located_code.center.x, located_code.center.y),
+      -located_code.rotation_angle, 1.0);
+}
+
+absl::variant<std::unique_ptr<QRImage>, std::string> NormalizeCode(
+    cv::Mat image, const LocatedCode& located_code,
+    const NormalizeOptions& options, cv::Mat* scratch) {
+  cv::Mat rotation_matrix = NormalizationMatrix(located_code);
+
+  cv::Rect region(0, 0, image.cols, image.rows);
+  if (options.crop_to_code) {
+    PositioningPoints points = located_code.positioning_points;
+    for (Point* point :
+         {&points.top_left, &points.top_right, &points.bottom_left}) {
+      *point = TransformPoint(*point, rotation_matrix);
+    }
+
+    region = CodeRegion(points, {image.cols, image.rows});
+    if (region.area() == 0) {
+      return "code lies outside the image";
+    }
+
+    // Shift the rotation so the region's corner lands on the origin.
+    rotation_matrix.at<double>(0, 2) -= region.x;
+    rotation_matrix.at<double>(1, 2) -= region.y;
+  }
+
+  cv::Mat& rotated_image = *scratch;
+  cv::warpAffine(image, rotated_image, rotation_matrix, region.size());
+
+  // Rotation introduces gray along the edges, so we have to threshold again.
+  // The input is already black and white, so lighting isn't a concern and a
+  // global threshold will do regardless of how it was binarized.
+  GlobalBinarizer().Binarize(rotated_image, rotated_image);
 
   auto qr_code = absl::make_unique<QRImage>();
   qr_code->image = rotated_image;
-  qr_code->positioning_points = points;
-  qr_code->center = CalculateCodeCenter(points);
+  qr_code->origin = Point(region.x, region.y);
+  qr_code->positioning_points = NormalizePositioningPoints(
+      located_code, rotation_matrix, PixelIteratorFromGrayImage(rotated_image));
+  qr_code->center = CalculateCodeCenter(qr_code->positioning_points);
+
+  return qr_code;
+}
+
+std::unique_ptr<QRImageView> NormalizeCodeView(
+    cv::Mat image, const LocatedCode& located_code) {
+  const cv::Mat rotation_matrix = NormalizationMatrix(located_code);
+
+  auto qr_code = absl::make_unique<QRImageView>();
+  qr_code->image = absl::make_unique<RotatedImage>(image, rotation_matrix);
+  qr_code->positioning_points =
+      NormalizePositioningPoints(located_code, rotation_matrix,
+                                 RotatedPixelIterator(qr_code->image.get()));
+  qr_code->center = CalculateCodeCenter(qr_code->positioning_points);
 
   return qr_code;
 }
@@ -1,22 +1,64 @@
 #ifndef _QRCODE_QR_NORMALIZE_H_
 #define _QRCODE_QR_NORMALIZE_H_ 1
 
+#include <memory>
+
 #include "absl/types/variant.h"
 #include "opencv2/opencv.hpp"
 
 #include "qrcode/point.h"
 #include "qrcode/qr_locate.h"
 #include "qrcode/qr_types.h"
+#include "qrcode/rotated_image.h"
 
 // A normalized (straightened) version of the QR code
 struct QRImage {
   cv::Mat image;
   PositioningPoints positioning_points;
   Point center;
+
+  // Where image's top left corner lies in the straightened frame. Non-zero
+  // only if image was cropped. positioning_points and center are relative to
+  // image, so adding origin gives their straightened frame coordinates.
+  Point origin;
+};
+
+// Controls how NormalizeCode builds the normalized image.
+struct NormalizeOptions {
+  // If set, only the part of the straightened frame around the code, with
+  // room for its quiet zone, is built and thresholded, so the cost depends on
+  // the size of the code rather than the size of the frame. Otherwise the
+  // normalized image is the whole straightened frame.
+  bool crop_to_code = false;
+};
+
+// As QRImage, but the normalized image is a view that reads the original
+// image as needed.
+struct QRImageView {
+  std::unique_ptr<RotatedImage> image;
+  PositioningPoints positioning_points;
+  Point center;
 };
 
+// Returns the transform NormalizeCode applies to straighten a located code.
+cv::Mat NormalizationMatrix(const LocatedCode& located_code);
+
 // Extract a normalized version of a QR code from an image.
 absl::variant<std::unique_ptr<QRImage>, std::string> NormalizeCode(
-    cv::Mat image, const LocatedCode& located_code);
+    cv::Mat image, const LocatedCode& located_code,
+    const NormalizeOptions& options = NormalizeOptions());
+
+// As above, but the normalized image is built in *scratch, whose buffer is
+// reused if it's already the right size. The returned QRImage shares that
+// buffer, so it's only good until the next call with the same scratch.
+absl::variant<std::unique_ptr<QRImage>, std::string> NormalizeCode(
+    cv::Mat image, const LocatedCode& located_code,
+    const NormalizeOptions& options, cv::Mat* scratch);
+
+// As above, but without building the normalized image. Its pixels are read
+// from image only when they're needed. The view shares image's pixel data, as
+// RotatedImage does.
+std::unique_ptr<QRImageView> NormalizeCodeView(cv::Mat image,
+                                               const LocatedCode& located_code);
 
 #endif  // _QRCODE_QR_NORMALIZE_H_
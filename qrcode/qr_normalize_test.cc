@@ -23,7 +23,7 @@ TEST(NormalizeCodeTest, Test) {
   // If this fails, the output of LocateCode has changed, which means
   // assertion failures from NormalizeCode results are likely the fault
   // of LocateCode changes -- not problems with NormalizeCode.
-  ASSERT_THAT(located_code->center, Eq(Point(1107, 1110)));
+  ASSERT_THAT(located_code->center, Eq(Point(1099, 1106)));
 
   auto extract_result = NormalizeCode(image, *located_code);
   ASSERT_THAT(extract_result, VariantWith<std::unique_ptr<QRImage>>(_));
@@ -31,15 +31,64 @@ TEST(NormalizeCodeTest, Test) {
       std::move(absl::get<std::unique_ptr<QRImage>>(extract_result));
 
   PositioningPoints expected_points = {
-      {669, 684},
-      {1526, 678},
-      {671, 1543},
+      {671, 679},
+      {1527, 674},
+      {671, 1537},
   };
   EXPECT_THAT(qr_image->positioning_points, Eq(expected_points));
 
-  // The center moves, not because of the rotation, but because NormalizeCode
-  // recenters the positioning points.
-  EXPECT_THAT(qr_image->center, Eq(Point(1098, 1111)));
+  // NormalizeCode recenters the positioning points, which could move the
+  // center, but LocateCode's points are already centered.
+  EXPECT_THAT(qr_image->center, Eq(Point(1099, 1106)));
+}
+
+TEST(NormalizeCodeTest, Crop) {
+  cv::Mat image = cv::imread(kTestImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(image.data != nullptr);
+
+  std::unique_ptr<LocatedCode> located_code =
+      std::move(absl::get<std::unique_ptr<LocatedCode>>(LocateCode(image)));
+
+  auto full_result = NormalizeCode(image, *located_code);
+  ASSERT_THAT(full_result, VariantWith<std::unique_ptr<QRImage>>(_));
+  const QRImage& full = *absl::get<std::unique_ptr<QRImage>>(full_result);
+
+  NormalizeOptions options;
+  options.crop_to_code = true;
+  auto crop_result = NormalizeCode(image, *located_code, options);
+  ASSERT_THAT(crop_result, VariantWith<std::unique_ptr<QRImage>>(_));
+  const QRImage& crop = *absl::get<std::unique_ptr<QRImage>>(crop_result);
+
+  EXPECT_LT(crop.image.total(), full.image.total());
+  EXPECT_THAT(crop.origin, Eq(Point(150, 152)));
+
+  // The cropped image is a window on the full one, so the points are the
+  // same once translated.
+  auto translate = [&](const Point& point) {
+    return Point(point.x + crop.origin.x, point.y + crop.origin.y);
+  };
+  EXPECT_THAT(translate(crop.positioning_points.top_left),
+              Eq(full.positioning_points.top_left));
+  EXPECT_THAT(translate(crop.positioning_points.top_right),
+              Eq(full.positioning_points.top_right));
+  EXPECT_THAT(translate(crop.positioning_points.bottom_left),
+              Eq(full.positioning_points.bottom_left));
+  EXPECT_THAT(translate(crop.center), Eq(full.center));
+}
+
+TEST(NormalizeCodeTest, CropOutsideImage) {
+  cv::Mat image = cv::imread(kTestImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(image.data != nullptr);
+
+  LocatedCode located_code;
+  located_code.positioning_points = {{-500, -500}, {-400, -500}, {-500, -400}};
+  located_code.center = {-450, -450};
+  located_code.rotation_angle = 0;
+
+  NormalizeOptions options;
+  options.crop_to_code = true;
+  EXPECT_THAT(NormalizeCode(image, located_code, options),
+              VariantWith<std::string>("code lies outside the image"));
 }
 
 }  // namespace
@@ -2,10 +2,14 @@
 
 #include "qrcode/runner.h"
 
-Point RecenterPositioningPoint(const Point& point,
-                               PixelIterator<const unsigned char> iter) {
-  auto measure = [](DirectionalIterator<const unsigned char> iter) {
-    auto result = Runner(iter).Next(1, nullptr);
+namespace {
+
+template <class PixelIter>
+Point Recenter(const Point& point, PixelIter iter) {
+  using Directional = decltype(iter.MakeForwardRowIterator());
+  auto measure = [](Directional iter) {
+    FixedRunner<1, Directional> runner(iter);
+    auto result = runner.Next(1, nullptr);
     if (result.has_value()) {
       return (*result)[0];
     } else {
@@ -33,3 +37,14 @@ Point RecenterPositioningPoint(const Point& point,
 
   return out;
 }
+
+}  // namespace
+
+Point RecenterPositioningPoint(const Point& point,
+                               PixelIterator<const unsigned char> iter) {
+  return Recenter(point, iter);
+}
+
+Point RecenterPositioningPoint(const Point& point, RotatedPixelIterator iter) {
+  return Recenter(point, iter);
+}
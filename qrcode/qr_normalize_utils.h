@@ -3,6 +3,7 @@
 
 #include "qrcode/pixel_iterator.h"
 #include "qrcode/qr_types.h"
+#include "qrcode/rotated_image.h"
 
 // Given a point that's roughly in the middle of the center black box
 // of a positioning point, recenter it by measuring the distances to
@@ -11,4 +12,7 @@
 Point RecenterPositioningPoint(const Point& point,
                                PixelIterator<const unsigned char> iter);
 
+// As above, for a rotated view of an image.
+Point RecenterPositioningPoint(const Point& point, RotatedPixelIterator iter);
+
 #endif  // _QRCODE_QR_NORMALIZE_UTILS_H_
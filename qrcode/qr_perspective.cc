@@ -0,0 +1,502 @@
+#include "qrcode/qr_perspective.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/optional.h"
+
+#include "qrcode/qr_attributes.h"
+
+namespace {
+
+using Coord = Homography::Coord;
+
+// As with GlobalBinarizer, pixels greater than this are white.
+constexpr int kThreshold = 127;
+
+// Module coordinates of the positioning point centers, measured from the
+// nearest corner of the code, and of the bottom right alignment pattern's
+// center, measured from the bottom right corner.
+constexpr double kPositioningCenter = 3.5;
+constexpr double kAlignmentCenter = 6.5;
+
+constexpr int kMinDimension = 21;
+constexpr int kMaxDimension = 177;
+
+// How far, in modules, to look for alignment patterns. The bottom right one
+// is predicted from the positioning points alone, so could be a long way
+// off. The others are predicted from their neighbors.
+constexpr double kCornerSearchRadius = 5;
+constexpr double kGridSearchRadius = 3;
+
+bool InImage(const cv::Mat& image, int x, int y) {
+  return x >= 0 && x < image.cols && y >= 0 && y < image.rows;
+}
+
+bool IsBlack(const cv::Mat& image, int x, int y) {
+  return image.ptr<unsigned char>(y)[x] <= kThreshold;
+}
+
+Coord ToCoord(const Point& point) { return {1.0 * point.x, 1.0 * point.y}; }
+
+// Walks the pixels on the line from `from` to `to`, and returns the lengths
+// of the runs of one color along it, in pixels. The first run starts at
+// `from`. The walk stops early at the edge of the image, or once max_runs runs
+// have ended.
+std::vector<double> LineRuns(const cv::Mat& image, const Coord& from,
+                             const Coord& to, int max_runs) {
+  std::vector<double> runs;
+
+  const double dx = to.x - from.x, dy = to.y - from.y;
+  const int steps = std::ceil(std::max(std::abs(dx), std::abs(dy)));
+  if (steps == 0) {
+    return runs;
+  }
+  const double step_x = dx / steps, step_y = dy / steps;
+  const double step_len = std::hypot(step_x, step_y);
+
+  int run = 0;
+  bool black = false;
+  for (int i = 0; i <= steps; ++i) {
+    const int x = std::lround(from.x + i * step_x);
+    const int y = std::lround(from.y + i * step_y);
+    if (!InImage(image, x, y)) {
+      break;
+    }
+
+    const bool pixel = IsBlack(image, x, y);
+    if (run > 0 && pixel != black) {
+      runs.push_back(run * step_len);
+      if (runs.size() == max_runs) {
+        return runs;
+      }
+      run = 0;
+    }
+    black = pixel;
+    ++run;
+  }
+
+  if (run > 0) {
+    runs.push_back(run * step_len);
+  }
+  return runs;
+}
+
+// Returns the width of the positioning point centered at center, measured
+// along the line through toward.
+absl::optional<double> PositioningPointWidth(const cv::Mat& image,
+                                             const Point& center,
+                                             const Point& toward) {
+  const Coord c = ToCoord(center);
+  const Coord fwd = ToCoord(toward);
+  const Coord back = {2 * c.x - fwd.x, 2 * c.y - fwd.y};
+
+  // From the center, the black box, the white ring, then the black ring. The
+  // fourth run must start, so we know where the third ends.
+  double width = 0;
+  for (const Coord& end : {fwd, back}) {
+    const std::vector<double> runs = LineRuns(image, c, end, 4);
+    if (runs.size() < 4) {
+      return absl::nullopt;
+    }
+    width += runs[0] + runs[1] + runs[2];
+  }
+  return width;
+}
+
+// Returns the average width of a module, from the widths of the positioning
+// points along the sides of the code.
+absl::optional<double> EstimateModuleSize(const cv::Mat& image,
+                                          const PositioningPoints& points) {
+  const std::pair<Point, Point> kLines[] = {
+      {points.top_left, points.top_right},
+      {points.top_left, points.bottom_left},
+      {points.top_right, points.top_left},
+      {points.bottom_left, points.top_left},
+  };
+
+  double sum = 0;
+  int num = 0;
+  for (const auto& line : kLines) {
+    absl::optional<double> width =
+        PositioningPointWidth(image, line.first, line.second);
+    if (width.has_value()) {
+      sum += *width;
+      ++num;
+    }
+  }
+
+  if (num == 0) {
+    return absl::nullopt;
+  }
+  return sum / num / 7;
+}
+
+// Returns the nearest valid dimension (one that's 1 mod 4) to the one implied
+// by the distances between the positioning points.
+int EstimateDimension(const PositioningPoints& points, double module_size) {
+  const double across = std::hypot(points.top_right.x - points.top_left.x,
+                                   points.top_right.y - points.top_left.y);
+  const double down = std::hypot(points.bottom_left.x - points.top_left.x,
+                                 points.bottom_left.y - points.top_left.y);
+  const double raw =
+      (across + down) / 2 / module_size + 2 * kPositioningCenter;
+  return 4 * std::lround((raw - 1) / 4) + 1;
+}
+
+// Returns the homography that puts the positioning point centers of a code of
+// the given dimension on points, and the bottom right corner on
+// bottom_right_image. bottom_right_module gives the module coordinates of
+// whatever lies at bottom_right_image.
+absl::optional<Homography> MakeModuleToImage(const PositioningPoints& points,
+                                             int dimension,
+                                             double bottom_right_module,
+                                             const Coord& bottom_right_image) {
+  const double near = kPositioningCenter;
+  const double far = dimension - kPositioningCenter;
+  return Homography::FromQuads(
+      {{{near, near},
+        {far, near},
+        {bottom_right_module, bottom_right_module},
+        {near, far}}},
+      {{ToCoord(points.top_left), ToCoord(points.top_right),
+        bottom_right_image, ToCoord(points.bottom_left)}});
+}
+
+// Returns the dimension implied by the timing patterns, or nullopt if they
+// can't be read or disagree. module_to_image is a first guess at the
+// geometry for a code of the given dimension, which needs to be good enough
+// to follow the timing patterns.
+absl::optional<int> TimingDimension(const cv::Mat& image,
+                                    const Homography& module_to_image,
+                                    int dimension) {
+  // Row and column 6 run from the edge of one positioning point, through
+  // dimension-14 alternating timing modules that start and end white, to the
+  // edge of another. A code with 21 modules has 9 runs along each.
+  const double near = kPositioningCenter;
+  const double far = dimension - kPositioningCenter;
+  const double timing = 6.5;
+
+  auto count = [&](const Coord& from, const Coord& to) -> absl::optional<int> {
+    const int from_x = std::lround(from.x), from_y = std::lround(from.y);
+    if (!InImage(image, from_x, from_y) || !IsBlack(image, from_x, from_y)) {
+      return absl::nullopt;
+    }
+    return LineRuns(image, from, to, std::numeric_limits<int>::max()).size() +
+           12;
+  };
+
+  const absl::optional<int> across = count(module_to_image.Map(near, timing),
+                                           module_to_image.Map(far, timing));
+  const absl::optional<int> down = count(module_to_image.Map(timing, near),
+                                         module_to_image.Map(timing, far));
+  // A count that isn't 1 mod 4 was thrown off by noise. If only one count is
+  // plausible, trust it.
+  auto valid = [](const absl::optional<int>& n) {
+    return n.has_value() && *n % 4 == 1;
+  };
+  if (valid(across) && valid(down)) {
+    return across == down ? across : absl::nullopt;
+  }
+  return valid(across) ? across : valid(down) ? down : absl::nullopt;
+}
+
+bool NearModuleSize(double len, double module_size) {
+  return len >= module_size / 2 && len <= module_size * 3 / 2;
+}
+
+// Checks that center is inside the black center of an alignment pattern,
+// looking along the line through center in direction {dx, dy}. If it is,
+// returns the offset along that line to the middle of the black center.
+absl::optional<double> CheckAlignmentPattern(const cv::Mat& image,
+                                             const Coord& center, double dx,
+                                             double dy, double module_size) {
+  const double reach = 3 * module_size;
+  const std::vector<double> fwd = LineRuns(
+      image, center, {center.x + dx * reach, center.y + dy * reach}, 3);
+  const std::vector<double> back = LineRuns(
+      image, center, {center.x - dx * reach, center.y - dy * reach}, 3);
+
+  // The black center, the white ring, and the start of the black ring.
+  if (fwd.size() < 3 || back.size() < 3 ||
+      !NearModuleSize(fwd[0] + back[0], module_size) ||
+      !NearModuleSize(fwd[1], module_size) ||
+      !NearModuleSize(back[1], module_size)) {
+    return absl::nullopt;
+  }
+  return (fwd[0] - back[0]) / 2;
+}
+
+// Searches within radius modules of estimate for the center of an alignment
+// pattern, and returns the one closest to estimate.
+absl::optional<Coord> FindAlignmentPattern(const cv::Mat& image,
+                                           const Coord& estimate,
+                                           double module_size,
+                                           double radius_modules) {
+  const int radius = std::ceil(radius_modules * module_size);
+  const int min_x = std::max(0, static_cast<int>(estimate.x) - radius);
+  const int max_x =
+      std::min(image.cols - 1, static_cast<int>(estimate.x) + radius);
+  const int min_y = std::max(0, static_cast<int>(estimate.y) - radius);
+  const int max_y =
+      std::min(image.rows - 1, static_cast<int>(estimate.y) + radius);
+
+  absl::optional<Coord> best;
+  double best_distance = std::numeric_limits<double>::max();
+
+  struct Run {
+    int start, len;
+    bool black;
+  };
+  std::vector<Run> runs;
+  for (int y = min_y; y <= max_y; ++y) {
+    runs.clear();
+    for (int x = min_x; x <= max_x; ++x) {
+      const bool black = IsBlack(image, x, y);
+      if (runs.empty() || runs.back().black != black) {
+        runs.push_back({x, 0, black});
+      }
+      ++runs.back().len;
+    }
+
+    // Find white, black, white runs of about a module each, between black
+    // runs, then confirm them as a pattern looking up and down, and again
+    // across from the refined center.
+    for (int i = 2; i + 2 < runs.size(); ++i) {
+      if (!runs[i].black || !NearModuleSize(runs[i - 1].len, module_size) ||
+          !NearModuleSize(runs[i].len, module_size) ||
+          !NearModuleSize(runs[i + 1].len, module_size)) {
+        continue;
+      }
+
+      Coord center = {runs[i].start + (runs[i].len - 1) / 2.0, 1.0 * y};
+      const absl::optional<double> y_off =
+          CheckAlignmentPattern(image, center, 0, 1, module_size);
+      if (!y_off.has_value()) {
+        continue;
+      }
+      center.y += *y_off;
+
+      const absl::optional<double> x_off =
+          CheckAlignmentPattern(image, center, 1, 0, module_size);
+      if (!x_off.has_value()) {
+        continue;
+      }
+      center.x += *x_off;
+
+      const double distance =
+          std::hypot(center.x - estimate.x, center.y - estimate.y);
+      if (distance < best_distance) {
+        best = center;
+        best_distance = distance;
+      }
+    }
+  }
+
+  return best;
+}
+
+}  // namespace
+
+absl::variant<CodeGeometry, std::string> FindCodeGeometry(
+    cv::Mat image, const LocatedCode& located_code) {
+  const PositioningPoints& points = located_code.positioning_points;
+
+  const absl::optional<double> module_size = EstimateModuleSize(image, points);
+  if (!module_size.has_value()) {
+    return "failed to measure positioning points";
+  }
+
+  // Until we know better, assume the code is a parallelogram.
+  const Coord parallelogram_corner = {
+      1.0 * points.top_right.x + points.bottom_left.x - points.top_left.x,
+      1.0 * points.top_right.y + points.bottom_left.y - points.top_left.y};
+  auto parallelogram = [&](int dimension) {
+    return MakeModuleToImage(points, dimension,
+                             dimension - kPositioningCenter,
+                             parallelogram_corner);
+  };
+
+  int dimension = EstimateDimension(points, *module_size);
+  if (dimension >= kMinDimension && dimension <= kMaxDimension) {
+    // The timing patterns count the modules directly, so they're immune to
+    // error in the module size.
+    const absl::optional<Homography> estimate = parallelogram(dimension);
+    if (estimate.has_value()) {
+      dimension = TimingDimension(image, *estimate, dimension)
+                      .value_or(dimension);
+    }
+  }
+  if (dimension < kMinDimension || dimension > kMaxDimension) {
+    return absl::StrFormat("bad dimension %d", dimension);
+  }
+
+  absl::optional<Homography> module_to_image = parallelogram(dimension);
+  if (!module_to_image.has_value()) {
+    return "positioning points are collinear";
+  }
+
+  // Codes larger than the smallest have an alignment pattern near the bottom
+  // right corner, which tells us where that corner really is.
+  bool used_alignment_pattern = false;
+  if (dimension > kMinDimension) {
+    const double alignment = dimension - kAlignmentCenter;
+    const absl::optional<Coord> alignment_center =
+        FindAlignmentPattern(image, module_to_image->Map(alignment, alignment),
+                             *module_size, kCornerSearchRadius);
+    if (alignment_center.has_value()) {
+      absl::optional<Homography> corrected = MakeModuleToImage(
+          points, dimension, alignment, *alignment_center);
+      if (corrected.has_value()) {
+        module_to_image = corrected;
+        used_alignment_pattern = true;
+      }
+    }
+  }
+
+  return CodeGeometry{dimension, *module_to_image, used_alignment_pattern,
+                      *module_size};
+}
+
+ModuleGrid::ModuleGrid(int dimension, std::vector<int> lines,
+                       std::vector<Homography> regions)
+    : dimension_(dimension),
+      lines_(std::move(lines)),
+      regions_(std::move(regions)) {}
+
+int ModuleGrid::Band(int m) const {
+  if (lines_.size() < 2) {
+    return 0;
+  }
+  const int band =
+      std::upper_bound(lines_.begin(), lines_.end(), m) - lines_.begin() - 1;
+  return std::min(std::max(band, 0), static_cast<int>(lines_.size()) - 2);
+}
+
+Point ModuleGrid::ModuleCenter(int x, int y) const {
+  const int bands = std::max(static_cast<int>(lines_.size()) - 1, 1);
+  return regions_[Band(y) * bands + Band(x)].MapToPixel(x + 0.5, y + 0.5);
+}
+
+ModuleGrid BuildModuleGrid(cv::Mat image, const CodeGeometry& geometry,
+                           int* num_found) {
+  const Homography& global = geometry.module_to_image;
+  const int version = (geometry.dimension - 17) / 4;
+  std::vector<int> lines = QRAttributes::AlignmentCenters(version);
+  const int n = lines.size();
+
+  if (num_found != nullptr) {
+    *num_found = 0;
+  }
+  if (n < 2) {
+    return ModuleGrid(geometry.dimension, std::move(lines), {global});
+  }
+
+  // The points the regions are anchored on, row by row: one per pairing of
+  // lines. Most are alignment pattern centers. The three taken by positioning
+  // patterns are replaced by the positioning pattern centers, which are 3
+  // modules further out, and which the global homography maps exactly.
+  struct Anchor {
+    Coord module;
+    Coord image;
+    bool lattice;  // Whether module is on the pairing of lines.
+  };
+  std::vector<Anchor> anchors(n * n);
+  auto anchor = [&](int row, int col) -> Anchor& {
+    return anchors[row * n + col];
+  };
+
+  const double near = kPositioningCenter;
+  const double far = geometry.dimension - kPositioningCenter;
+  for (int row = 0; row < n; ++row) {
+    for (int col = 0; col < n; ++col) {
+      const bool top = row == 0, bottom = row == n - 1;
+      const bool left = col == 0, right = col == n - 1;
+      if ((top && left) || (top && right) || (bottom && left)) {
+        const Coord module = {right ? far : near, bottom ? far : near};
+        anchor(row, col) = {module, global.Map(module.x, module.y), false};
+        continue;
+      }
+
+      // If the neighbors above and to the left all moved the same way, this
+      // one probably did too.
+      const Coord module = {lines[col] + 0.5, lines[row] + 0.5};
+      Coord predicted = global.Map(module.x, module.y);
+      if (!top && !left && anchor(row, col - 1).lattice &&
+          anchor(row - 1, col).lattice && anchor(row - 1, col - 1).lattice) {
+        const Coord& l = anchor(row, col - 1).image;
+        const Coord& u = anchor(row - 1, col).image;
+        const Coord& d = anchor(row - 1, col - 1).image;
+        predicted = {l.x + u.x - d.x, l.y + u.y - d.y};
+      }
+
+      const absl::optional<Coord> found = FindAlignmentPattern(
+          image, predicted, geometry.module_size, kGridSearchRadius);
+      if (found.has_value() && num_found != nullptr) {
+        ++*num_found;
+      }
+      anchor(row, col) = {module, found.value_or(predicted), true};
+    }
+  }
+
+  std::vector<Homography> regions;
+  for (int row = 0; row + 1 < n; ++row) {
+    for (int col = 0; col + 1 < n; ++col) {
+      const Anchor* corners[] = {&anchor(row, col), &anchor(row, col + 1),
+                                 &anchor(row + 1, col + 1),
+                                 &anchor(row + 1, col)};
+      Homography::Quad from, to;
+      for (int i = 0; i < 4; ++i) {
+        from[i] = corners[i]->module;
+        to[i] = corners[i]->image;
+      }
+      regions.push_back(Homography::FromQuads(from, to).value_or(global));
+    }
+  }
+
+  return ModuleGrid(geometry.dimension, std::move(lines), std::move(regions));
+}
+
+absl::variant<std::unique_ptr<QRCodeArray>, std::string>
+ExtractCodeWithPerspective(cv::Mat image, const LocatedCode& located_code) {
+  auto maybe_geometry = FindCodeGeometry(image, located_code);
+  if (absl::holds_alternative<std::string>(maybe_geometry)) {
+    return absl::get<std::string>(maybe_geometry);
+  }
+  const CodeGeometry& geometry = absl::get<CodeGeometry>(maybe_geometry);
+  const ModuleGrid grid = BuildModuleGrid(image, geometry, nullptr);
+
+  // Confidence comes from pixels a quarter module from each module's center.
+  const int reach = std::max(1, static_cast<int>(geometry.module_size / 4));
+
+  auto qr_array =
+      absl::make_unique<QRCodeArray>(grid.dimension(), grid.dimension());
+  for (int y = 0; y < grid.dimension(); ++y) {
+    for (int x = 0; x < grid.dimension(); ++x) {
+      const Point pixel = grid.ModuleCenter(x, y);
+      if (!InImage(image, pixel.x, pixel.y)) {
+        return "code extends past the edge of the image";
+      }
+      const bool black = IsBlack(image, pixel.x, pixel.y);
+      qr_array->Set(Point(x, y), black);
+
+      int agreeing = 0, total = 0;
+      for (int dy = -reach; dy <= reach; dy += reach) {
+        for (int dx = -reach; dx <= reach; dx += reach) {
+          if (InImage(image, pixel.x + dx, pixel.y + dy)) {
+            ++total;
+            agreeing += IsBlack(image, pixel.x + dx, pixel.y + dy) == black;
+          }
+        }
+      }
+      qr_array->SetConfidence(
+          Point(x, y), QRCodeArray::ConfidenceFromSamples(agreeing, total));
+    }
+  }
+
+  return std::move(qr_array);
+}
@@ -0,0 +1,83 @@
+#ifndef _QRCODE_QR_PERSPECTIVE_H_
+#define _QRCODE_QR_PERSPECTIVE_H_ 1
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/variant.h"
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/homography.h"
+#include "qrcode/qr_array.h"
+#include "qrcode/qr_locate.h"
+
+// Where a located code's modules lie in the image it was located in.
+struct CodeGeometry {
+  // The number of modules along each side of the code.
+  int dimension;
+
+  // Maps module coordinates, with the top left corner of the code at {0, 0}
+  // and a module per unit, to image coordinates.
+  Homography module_to_image;
+
+  // Whether the bottom right alignment pattern was found, and so anchors the
+  // fourth corner of the homography. Otherwise the code is assumed to be a
+  // parallelogram.
+  bool used_alignment_pattern;
+
+  // The average width of a module, in pixels.
+  double module_size;
+};
+
+// Where a code's modules lie in the image, region by region. The rows and
+// columns through the alignment pattern centers divide the code into regions,
+// each with its own homography anchored on the patterns at its corners, so
+// the grid can follow a code that isn't flat. Modules beyond the outermost
+// rows and columns use the nearest region's homography.
+class ModuleGrid {
+ public:
+  // lines are the rows (and columns) dividing the regions, in increasing
+  // order, and regions holds one homography per region, row by row. If there
+  // are fewer than two lines, there's one region, covering the whole code.
+  ModuleGrid(int dimension, std::vector<int> lines,
+             std::vector<Homography> regions);
+
+  int dimension() const { return dimension_; }
+
+  // Returns the pixel at the center of the module at {x, y}.
+  Point ModuleCenter(int x, int y) const;
+
+ private:
+  // Returns the index of the band of regions holding module row (or column)
+  // m.
+  int Band(int m) const;
+
+  const int dimension_;
+  const std::vector<int> lines_;
+  const std::vector<Homography> regions_;
+};
+
+// Works out the geometry of a located code from its positioning points, the
+// timing patterns between them, and the bottom right alignment pattern if the
+// code has one. image is as for ExtractCodeWithPerspective.
+absl::variant<CodeGeometry, std::string> FindCodeGeometry(
+    cv::Mat image, const LocatedCode& located_code);
+
+// Builds the sampling grid for a code with the given geometry. Each alignment
+// pattern is searched for near where its neighbors put it; one that can't be
+// found is assumed to be there. If num_found is non-null, it's set to the
+// number of alignment patterns found. image is as for
+// ExtractCodeWithPerspective.
+ModuleGrid BuildModuleGrid(cv::Mat image, const CodeGeometry& geometry,
+                           int* num_found);
+
+// Reads the modules of a located code straight from image, correcting for
+// perspective. This does the work of NormalizeCode and ExtractCode in one
+// pass, without building a straightened image. image is the image the code
+// was located in; pixels greater than 127 are white, so it needn't have been
+// binarized.
+absl::variant<std::unique_ptr<QRCodeArray>, std::string>
+ExtractCodeWithPerspective(cv::Mat image, const LocatedCode& located_code);
+
+#endif  // _QRCODE_QR_PERSPECTIVE_H_
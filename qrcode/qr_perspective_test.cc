@@ -0,0 +1,319 @@
+#include "qrcode/qr_perspective.h"
+
+#include <cmath>
+#include <functional>
+
+#include "absl/memory/memory.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "qrcode/qr_array.h"
+#include "qrcode/qr_attributes.h"
+#include "qrcode/qr_extract.h"
+#include "qrcode/qr_locate.h"
+#include "qrcode/qr_normalize.h"
+#include "qrcode/testutils.h"
+
+namespace {
+
+constexpr char kTestImageRelPath[] = "qrcode/testdata/straight.png";
+constexpr char kTestBitsRelPath[] = "qrcode/testdata/straight.txt";
+constexpr char kTiltImageRelPath[] = "qrcode/testdata/tilt.png";
+
+void ExpectArraysEqual(const QRCodeArray& expected, const QRCodeArray& actual) {
+  ASSERT_EQ(expected.height(), actual.height());
+  ASSERT_EQ(expected.width(), actual.width());
+  for (int y = 0; y < expected.height(); ++y) {
+    for (int x = 0; x < expected.width(); ++x) {
+      Point p(x, y);
+      ASSERT_EQ(expected.Get(p), actual.Get(p)) << p;
+    }
+  }
+}
+
+TEST(ExtractCodeWithPerspectiveTest, Straight) {
+  cv::Mat image = cv::imread(kTestImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(image.data != nullptr);
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<LocatedCode> located_code,
+                   LocateCode(image), "locate returned error");
+
+  ASSIGN_OR_ASSERT(CodeGeometry geometry,
+                   FindCodeGeometry(image, *located_code),
+                   "geometry returned error");
+  EXPECT_EQ(29, geometry.dimension);
+  EXPECT_TRUE(geometry.used_alignment_pattern);
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ExtractCodeWithPerspective(image, *located_code),
+                   "extract returned error");
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> expected_array,
+                   ReadQRCodeArrayFromFile(kTestBitsRelPath),
+                   "read returned error");
+  ExpectArraysEqual(*expected_array, *array);
+}
+
+// A rotated code must read the same as it does after straightening.
+TEST(ExtractCodeWithPerspectiveTest, Tilt) {
+  cv::Mat image = cv::imread(kTiltImageRelPath, cv::IMREAD_GRAYSCALE);
+  ASSERT_TRUE(image.data != nullptr);
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<LocatedCode> located_code,
+                   LocateCode(image), "locate returned error");
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRImage> qr_image,
+                   NormalizeCode(image, *located_code),
+                   "normalize returned error");
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> expected_array,
+                   ExtractCode(*qr_image), "extract returned error");
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ExtractCodeWithPerspective(image, *located_code),
+                   "extract with perspective returned error");
+  ExpectArraysEqual(*expected_array, *array);
+}
+
+// Draws array into a size x size image. image_to_module maps each pixel to
+// the module coordinates it shows. Pixels outside the code are white.
+cv::Mat DrawMappedCode(
+    const QRCodeArray& array, int size,
+    const std::function<Homography::Coord(double, double)>& image_to_module) {
+  cv::Mat image(size, size, CV_8UC1, cv::Scalar(255));
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const Homography::Coord module = image_to_module(x, y);
+      const int module_x = std::floor(module.x);
+      const int module_y = std::floor(module.y);
+      if (module_x >= 0 && module_x < array.width() && module_y >= 0 &&
+          module_y < array.height() && array.Get(Point(module_x, module_y))) {
+        image.at<unsigned char>(y, x) = 0;
+      }
+    }
+  }
+  return image;
+}
+
+// Draws array, with a quiet zone, into a size x size image such that its
+// corners land on the corners of to.
+cv::Mat DrawCode(const QRCodeArray& array, int size,
+                 const Homography::Quad& to) {
+  constexpr int kQuietZone = 4;
+  const double lo = -kQuietZone;
+  const double hi = array.width() + kQuietZone;
+  const Homography::Quad from = {{{lo, lo}, {hi, lo}, {hi, hi}, {lo, hi}}};
+  const Homography image_to_module = *Homography::FromQuads(to, from);
+
+  return DrawMappedCode(array, size, [&](double x, double y) {
+    return image_to_module.Map(x, y);
+  });
+}
+
+TEST(ExtractCodeWithPerspectiveTest, Perspective) {
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> expected_array,
+                   ReadQRCodeArrayFromFile(kTestBitsRelPath),
+                   "read returned error");
+
+  // The code as seen by a camera looking up at it from below: the bottom edge
+  // is wider than the top, so the parallelogram through the three positioning
+  // points puts the bottom right corner in the wrong place. Straightening by
+  // rotation miscounts the modules here.
+  cv::Mat image = DrawCode(*expected_array, 800,
+                           {{{160, 100}, {640, 100}, {700, 700}, {100, 700}}});
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<LocatedCode> located_code,
+                   LocateCode(image), "locate returned error");
+
+  ASSIGN_OR_ASSERT(CodeGeometry geometry,
+                   FindCodeGeometry(image, *located_code),
+                   "geometry returned error");
+  EXPECT_EQ(29, geometry.dimension);
+  EXPECT_TRUE(geometry.used_alignment_pattern);
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ExtractCodeWithPerspective(image, *located_code),
+                   "extract returned error");
+  ExpectArraysEqual(*expected_array, *array);
+}
+
+// A smudged module reads the same, but with less confidence.
+TEST(ExtractCodeWithPerspectiveTest, Confidence) {
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> expected_array,
+                   ReadQRCodeArrayFromFile(kTestBitsRelPath),
+                   "read returned error");
+
+  // 20-pixel modules, with a four module quiet zone.
+  constexpr int kModuleSize = 20;
+  const int size = (expected_array->width() + 8) * kModuleSize;
+  cv::Mat image =
+      DrawCode(*expected_array, size, {{{0, 0}, {1.0 * size, 0},
+                                        {1.0 * size, 1.0 * size},
+                                        {0, 1.0 * size}}});
+
+  // Flip the right part of module {10, 10}, leaving its center alone.
+  const Point smudged(10, 10);
+  const int center_x = (smudged.x + 4) * kModuleSize + kModuleSize / 2;
+  const int center_y = (smudged.y + 4) * kModuleSize + kModuleSize / 2;
+  for (int y = center_y - kModuleSize / 2; y < center_y + kModuleSize / 2;
+       ++y) {
+    for (int x = center_x + 2; x < center_x + kModuleSize / 2; ++x) {
+      unsigned char& pixel = image.at<unsigned char>(y, x);
+      pixel = 255 - pixel;
+    }
+  }
+
+  ASSIGN_OR_ASSERT(std::unique_ptr<LocatedCode> located_code,
+                   LocateCode(image), "locate returned error");
+  ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                   ExtractCodeWithPerspective(image, *located_code),
+                   "extract returned error");
+  ExpectArraysEqual(*expected_array, *array);
+
+  for (int y = 0; y < array->height(); ++y) {
+    for (int x = 0; x < array->width(); ++x) {
+      const Point p(x, y);
+      if (p == smudged) {
+        EXPECT_LT(array->GetConfidence(p), QRCodeArray::kCertain / 2);
+      } else {
+        EXPECT_EQ(QRCodeArray::kCertain, array->GetConfidence(p)) << p;
+      }
+    }
+  }
+}
+
+// Returns a code of the given version with its positioning, timing, and
+// alignment patterns in place, and arbitrary modules everywhere else.
+std::unique_ptr<QRCodeArray> MakeCode(int version) {
+  const int dimension = 17 + 4 * version;
+  auto array = absl::make_unique<QRCodeArray>(dimension, dimension);
+
+  unsigned int seed = 1;
+  for (int y = 0; y < dimension; ++y) {
+    for (int x = 0; x < dimension; ++x) {
+      seed = seed * 1103515245 + 12345;
+      array->Set(Point(x, y), (seed >> 16) & 1);
+    }
+  }
+
+  // Draws a square pattern of concentric rings, alternating black and white
+  // from the outside in, filling side x side modules around center.
+  auto draw_rings = [&](int center_x, int center_y, int side) {
+    const int half = side / 2;
+    for (int dy = -half; dy <= half; ++dy) {
+      for (int dx = -half; dx <= half; ++dx) {
+        const int ring = half - std::max(std::abs(dx), std::abs(dy));
+        array->Set(Point(center_x + dx, center_y + dy), ring % 2 == 0);
+      }
+    }
+  };
+
+  for (int y = 8; y < dimension - 8; ++y) {
+    array->Set(Point(6, y), y % 2 == 0);
+    array->Set(Point(y, 6), y % 2 == 0);
+  }
+
+  const std::vector<int> centers = QRAttributes::AlignmentCenters(version);
+  for (int cy : centers) {
+    for (int cx : centers) {
+      // The ones that would overlap positioning patterns aren't there.
+      const int first = centers.front(), last = centers.back();
+      if ((cx == first && cy == first) || (cx == first && cy == last) ||
+          (cx == last && cy == first)) {
+        continue;
+      }
+      draw_rings(cx, cy, 5);
+    }
+  }
+
+  // Positioning patterns, with their white separators.
+  for (const Point& center : {Point(3, 3), Point(dimension - 4, 3),
+                              Point(3, dimension - 4)}) {
+    for (int dy = -4; dy <= 4; ++dy) {
+      for (int dx = -4; dx <= 4; ++dx) {
+        const Point p(center.x + dx, center.y + dy);
+        if (p.x >= 0 && p.x < dimension && p.y >= 0 && p.y < dimension) {
+          array->Set(p, false);
+        }
+      }
+    }
+    draw_rings(center.x, center.y, 7);
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        array->Set(Point(center.x + dx, center.y + dy), true);
+      }
+    }
+  }
+
+  return array;
+}
+
+// A code on a curved surface, whose middle bulges downward, can't be followed
+// by a single homography. The alignment patterns let the grid bend with it.
+TEST(ExtractCodeWithPerspectiveTest, Curved) {
+  for (int version : {7, 14}) {
+    const std::unique_ptr<QRCodeArray> expected_array = MakeCode(version);
+    const int dimension = expected_array->width();
+
+    constexpr int kModuleSize = 10;
+    constexpr int kMargin = 6 * kModuleSize;
+    const double bulge = 1.5 * kModuleSize;
+    cv::Mat image = DrawMappedCode(
+        *expected_array, dimension * kModuleSize + 2 * kMargin,
+        [&](double x, double y) -> Homography::Coord {
+          const double module_x = (x - kMargin) / kModuleSize;
+          const double drop = bulge * std::sin(M_PI * module_x / dimension);
+          return {module_x, (y - kMargin - drop) / kModuleSize};
+        });
+
+    ASSIGN_OR_ASSERT(std::unique_ptr<LocatedCode> located_code,
+                     LocateCode(image), "locate returned error");
+    ASSIGN_OR_ASSERT(CodeGeometry geometry,
+                     FindCodeGeometry(image, *located_code),
+                     "geometry returned error");
+    ASSERT_EQ(dimension, geometry.dimension) << version;
+
+    // Every alignment pattern that doesn't collide with a positioning
+    // pattern.
+    const int num_lines = QRAttributes::AlignmentCenters(version).size();
+    int num_found;
+    const ModuleGrid grid = BuildModuleGrid(image, geometry, &num_found);
+    EXPECT_EQ(num_lines * num_lines - 3, num_found) << version;
+
+    int grid_mismatches = 0, global_mismatches = 0;
+    for (int y = 0; y < dimension; ++y) {
+      for (int x = 0; x < dimension; ++x) {
+        const Point p(x, y);
+        const Point grid_pixel = grid.ModuleCenter(x, y);
+        const Point global_pixel =
+            geometry.module_to_image.MapToPixel(x + 0.5, y + 0.5);
+        const bool expected = expected_array->Get(p);
+        grid_mismatches +=
+            (image.at<unsigned char>(grid_pixel.y, grid_pixel.x) == 0) !=
+            expected;
+        global_mismatches +=
+            (image.at<unsigned char>(global_pixel.y, global_pixel.x) == 0) !=
+            expected;
+      }
+    }
+    EXPECT_EQ(0, grid_mismatches) << version;
+    EXPECT_GT(global_mismatches, 0) << version;
+
+    ASSIGN_OR_ASSERT(std::unique_ptr<QRCodeArray> array,
+                     ExtractCodeWithPerspective(image, *located_code),
+                     "extract returned error");
+    ExpectArraysEqual(*expected_array, *array);
+  }
+}
+
+TEST(ExtractCodeWithPerspectiveTest, NoCode) {
+  cv::Mat image(200, 200, CV_8UC1, cv::Scalar(255));
+
+  LocatedCode located_code;
+  located_code.positioning_points = {{50, 50}, {150, 50}, {50, 150}};
+  located_code.center = {100, 100};
+  located_code.rotation_angle = 0;
+
+  EXPECT_THAT(ExtractCodeWithPerspective(image, located_code),
+              ::testing::VariantWith<std::string>(
+                  "failed to measure positioning points"));
+}
+
+}  // namespace
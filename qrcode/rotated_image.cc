@@ -0,0 +1,25 @@
+#include "qrcode/rotated_image.h"
+
+#include <cmath>
+
+RotatedImage::RotatedImage(const cv::Mat& image, const cv::Mat& matrix,
+                           int threshold)
+    : image_(image), threshold_(threshold) {
+  const double a = matrix.at<double>(0, 0), b = matrix.at<double>(0, 1),
+               c = matrix.at<double>(0, 2), d = matrix.at<double>(1, 0),
+               e = matrix.at<double>(1, 1), f = matrix.at<double>(1, 2);
+
+  // Invert the 2x2 linear part, then undo the translation.
+  const double det = a * e - b * d;
+  inverse_[0] = e / det;
+  inverse_[1] = -b / det;
+  inverse_[3] = -d / det;
+  inverse_[4] = a / det;
+  inverse_[2] = -(inverse_[0] * c + inverse_[1] * f);
+  inverse_[5] = -(inverse_[3] * c + inverse_[4] * f);
+}
+
+Point RotatedImage::ToSource(int x, int y) const {
+  return Point(std::lround(inverse_[0] * x + inverse_[1] * y + inverse_[2]),
+               std::lround(inverse_[3] * x + inverse_[4] * y + inverse_[5]));
+}
@@ -0,0 +1,96 @@
+#ifndef _QRCODE_ROTATED_IMAGE_H_
+#define _QRCODE_ROTATED_IMAGE_H_ 1
+
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/pixel_iterator.h"
+#include "qrcode/point.h"
+
+// A black-and-white view of an image after an affine transformation, such as
+// the rotation NormalizeCode uses to straighten a code. The view is the same
+// size as the image. Each read maps its pixel back to the source image and
+// thresholds the nearest source pixel there, so the transformed image is never
+// built. Pixels that map to points outside the source image are black, as
+// they would be after cv::warpAffine.
+class RotatedImage {
+ public:
+  // matrix is the 2x3 CV_64F forward transform, as would be passed to
+  // cv::warpAffine. The view keeps a reference to image's pixel data, as a
+  // cv::Mat copy does, so later writes to those pixels show through it. As
+  // with GlobalBinarizer, source pixels greater than threshold are white
+  // (255), and the rest are black (0).
+  RotatedImage(const cv::Mat& image, const cv::Mat& matrix,
+               int threshold = 127);
+  ~RotatedImage() = default;
+
+  RotatedImage(const RotatedImage&) = delete;
+
+  int width() const { return image_.cols; }
+  int height() const { return image_.rows; }
+
+  unsigned char Get(int x, int y) const {
+    const Point source = ToSource(x, y);
+    if (source.x < 0 || source.x >= image_.cols || source.y < 0 ||
+        source.y >= image_.rows) {
+      return 0;
+    }
+    return image_.ptr<unsigned char>(source.y)[source.x] > threshold_ ? 255
+                                                                       : 0;
+  }
+
+  // Returns the source image pixel nearest to where {x, y} in the view comes
+  // from.
+  Point ToSource(int x, int y) const;
+
+ private:
+  const cv::Mat image_;
+  const int threshold_;
+
+  // The inverse transform, as a row-major 2x3 matrix.
+  double inverse_[6];
+};
+
+// A PixelIterator for RotatedImages.
+class RotatedPixelIterator {
+ public:
+  explicit RotatedPixelIterator(const RotatedImage* image)
+      : x_(0), y_(0), image_(image) {}
+  ~RotatedPixelIterator() = default;
+
+  bool Seek(int x, int y) {
+    if (y < 0 || y >= image_->height() || x < 0 || x >= image_->width()) {
+      return false;
+    }
+
+    x_ = x;
+    y_ = y;
+    return true;
+  }
+
+  bool RelSeek(int delta_x, int delta_y) {
+    return Seek(x_ + delta_x, y_ + delta_y);
+  }
+
+  bool Seek(Point p) { return Seek(p.x, p.y); }
+
+  unsigned char Get() { return image_->Get(x_, y_); }
+
+  // Rows of the view don't lie along rows of the source, so there's no faster
+  // way to find runs than pixel by pixel. See
+  // DirectionalIterator::ForwardRowRunLength.
+  int ForwardRowRunLength(int* remaining) { return 0; }
+
+  using Directional =
+      DirectionalIterator<const unsigned char, RotatedPixelIterator>;
+
+  Directional MakeForwardRowIterator() { return Directional(*this, 1, 0); }
+  Directional MakeReverseRowIterator() { return Directional(*this, -1, 0); }
+  Directional MakeForwardColumnIterator() { return Directional(*this, 0, 1); }
+  Directional MakeReverseColumnIterator() { return Directional(*this, 0, -1); }
+
+ private:
+  int x_, y_;
+  const RotatedImage* image_;
+};
+
+#endif  // _QRCODE_ROTATED_IMAGE_H_
@@ -0,0 +1,82 @@
+#include "qrcode/rotated_image.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/runner.h"
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Optional;
+
+cv::Mat MakeImage() {
+  // 0   10  20  30  40  50  60  70  80  90 ...
+  cv::Mat image(4, 6, CV_8UC1);
+  for (int y = 0; y < image.rows; ++y) {
+    for (int x = 0; x < image.cols; ++x) {
+      image.at<uchar>(y, x) = (y * image.cols + x) * 10;
+    }
+  }
+  return image;
+}
+
+TEST(RotatedImageTest, Identity) {
+  const cv::Mat image = MakeImage();
+  const cv::Mat identity = cv::getRotationMatrix2D(cv::Point2f(0, 0), 0, 1.0);
+  RotatedImage rotated(image, identity, 100);
+
+  ASSERT_EQ(6, rotated.width());
+  ASSERT_EQ(4, rotated.height());
+  for (int y = 0; y < image.rows; ++y) {
+    for (int x = 0; x < image.cols; ++x) {
+      EXPECT_EQ(Point(x, y), rotated.ToSource(x, y));
+      EXPECT_EQ(image.at<uchar>(y, x) > 100 ? 255 : 0, rotated.Get(x, y))
+          << x << "," << y;
+    }
+  }
+}
+
+TEST(RotatedImageTest, Rotate) {
+  const cv::Mat image = MakeImage();
+
+  // A quarter turn counterclockwise about {2, 2}: the pixel at {x, y} in the
+  // image ends up at {y, 4 - x} in the view.
+  const cv::Mat matrix = cv::getRotationMatrix2D(cv::Point2f(2, 2), 90, 1.0);
+  RotatedImage rotated(image, matrix, 100);
+
+  EXPECT_EQ(Point(2, 2), rotated.ToSource(2, 2));
+  EXPECT_EQ(Point(4, 0), rotated.ToSource(0, 0));
+  EXPECT_EQ(Point(0, 3), rotated.ToSource(3, 4));
+
+  // Row 0 of the view is column 4 of the image, read upwards.
+  EXPECT_EQ(0, rotated.Get(0, 0));    // 40
+  EXPECT_EQ(0, rotated.Get(1, 0));    // 100 isn't greater than 100
+  EXPECT_EQ(255, rotated.Get(2, 0));  // 160
+  EXPECT_EQ(255, rotated.Get(3, 0));  // 220
+  EXPECT_EQ(0, rotated.Get(4, 0));    // outside the image
+  EXPECT_EQ(0, rotated.Get(5, 0));    // outside the image
+}
+
+TEST(RotatedPixelIteratorTest, Runs) {
+  cv::Mat image(8, 8, CV_8UC1, cv::Scalar(255));
+  for (int y = 0; y < 8; ++y) {
+    image.at<uchar>(y, 2) = 0;
+  }
+
+  // A quarter turn about the center makes the black column a black row.
+  const cv::Mat matrix = cv::getRotationMatrix2D(cv::Point2f(3.5, 3.5), 90, 1);
+  RotatedImage rotated(image, matrix);
+
+  RotatedPixelIterator iter(&rotated);
+  ASSERT_TRUE(iter.Seek(0, 0));
+  FixedRunner<3, RotatedPixelIterator::Directional> runner(
+      iter.MakeForwardRowIterator());
+  EXPECT_THAT(runner.Next(3, nullptr), Optional(ElementsAre(5, 1, 2)));
+
+  EXPECT_FALSE(iter.Seek(8, 0));
+  EXPECT_FALSE(iter.Seek(0, -1));
+}
+
+}  // namespace
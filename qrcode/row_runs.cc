@@ -0,0 +1,64 @@
+#include "qrcode/row_runs.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+int RowRunLengthScalar(const unsigned char* row, int len) {
+  const bool want = row[0] != 0;
+  int i;
+  for (i = 1; i < len; ++i) {
+    if ((row[i] != 0) != want) {
+      break;
+    }
+  }
+  return i;
+}
+
+int RowRunLength(const unsigned char* row, int len) {
+  const bool want = row[0] != 0;
+  int i = 0;
+
+  // Each block is compared against zero, giving a mask with bits set for zero
+  // pixels. Inverting it when the run is black (zero) leaves bits set only for
+  // the pixels that end the run, the first of which is found with ctz.
+#if defined(__AVX2__)
+  const __m256i zero32 = _mm256_setzero_si256();
+  const unsigned int flip32 = want ? 0 : ~0u;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i px =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+    const unsigned int ends =
+        static_cast<unsigned int>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(px, zero32))) ^
+        flip32;
+    if (ends != 0) {
+      return i + __builtin_ctz(ends);
+    }
+  }
+#endif
+
+#if defined(__SSE2__)
+  const __m128i zero16 = _mm_setzero_si128();
+  const unsigned int flip16 = want ? 0 : 0xffff;
+  for (; i + 16 <= len; i += 16) {
+    const __m128i px =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    const unsigned int ends =
+        static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(px, zero16))) ^
+        flip16;
+    if (ends != 0) {
+      return i + __builtin_ctz(ends);
+    }
+  }
+#endif
+
+  if (i == 0) {
+    return RowRunLengthScalar(row, len);
+  }
+
+  // Every pixel before i matches row[0], so the scalar scan can resume from
+  // i - 1, whose value is the one wanted.
+  return i - 1 + RowRunLengthScalar(row + i - 1, len - i + 1);
+}
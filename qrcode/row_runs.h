@@ -0,0 +1,17 @@
+#ifndef _QRCODE_ROW_RUNS_H_
+#define _QRCODE_ROW_RUNS_H_ 1
+
+// Returns the length of the run at the start of the len pixels beginning at
+// row -- that is, the number of pixels before the first one that differs from
+// row[0]. As with Runner, pixels are either 0 or non-zero. len must be at least
+// 1, and the pixels must be contiguous in memory.
+//
+// Uses AVX2 or SSE2, where the build enables them, to examine 32 or 16 pixels
+// at a time.
+int RowRunLength(const unsigned char* row, int len);
+
+// A pixel-at-a-time implementation of RowRunLength, used for the tail of each
+// row and on platforms without vector support.
+int RowRunLengthScalar(const unsigned char* row, int len);
+
+#endif  // _QRCODE_ROW_RUNS_H_
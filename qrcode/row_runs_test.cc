@@ -0,0 +1,53 @@
+#include "qrcode/row_runs.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(RowRunsTest, Uniform) {
+  for (unsigned char val : {0, 255}) {
+    for (int len : {1, 15, 16, 17, 31, 32, 33, 100}) {
+      std::vector<unsigned char> row(len, val);
+      EXPECT_EQ(len, RowRunLength(row.data(), len)) << len;
+      EXPECT_EQ(len, RowRunLengthScalar(row.data(), len)) << len;
+    }
+  }
+}
+
+TEST(RowRunsTest, EveryBoundary) {
+  // A single transition at every position, in both directions, so each lane
+  // of each block (and the scalar tail) gets to end a run.
+  for (unsigned char val : {0, 255}) {
+    for (int len = 1; len <= 80; ++len) {
+      std::vector<unsigned char> row(80, 255 - val);
+      std::fill(row.begin(), row.begin() + len, val);
+      EXPECT_EQ(len, RowRunLength(row.data(), row.size())) << len;
+    }
+  }
+}
+
+TEST(RowRunsTest, MatchesScalar) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> len_dist(1, 50);
+  std::uniform_int_distribution<int> val_dist(0, 255);
+
+  std::vector<unsigned char> row;
+  unsigned char val = 0;
+  while (row.size() < 4096) {
+    row.insert(row.end(), len_dist(gen), val);
+    // Use assorted non-zero values, which must not be told apart.
+    val = val == 0 ? val_dist(gen) | 1 : 0;
+  }
+
+  for (int start = 0; start < row.size(); ++start) {
+    const int len = row.size() - start;
+    ASSERT_EQ(RowRunLengthScalar(&row[start], len),
+              RowRunLength(&row[start], len))
+        << start;
+  }
+}
+
+}  // namespace
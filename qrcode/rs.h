@@ -0,0 +1,306 @@
+#ifndef _QRCODE_RS_H_
+#define _QRCODE_RS_H_ 1
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "absl/types/variant.h"
+
+#include "qrcode/gf.h"
+
+// Corrects errors in a Reed-Solomon codeword in place, using arithmetic from
+// gf. Field is GF or one of its subclasses, or a type with the same
+// interface, like FastGF256, whose arithmetic can be inlined.
+//
+// codeword holds the data symbols followed by num_ecc error correction
+// symbols, highest degree coefficient first, as they're stored in QR codes.
+// The generator polynomial is assumed to have roots alpha^0 through
+// alpha^(num_ecc-1), as QR codes' do. Up to num_ecc/2 symbol errors can be
+// corrected.
+//
+// Returns the number of symbols corrected, or an error if there were too many
+// to correct. codeword is unchanged if an error is returned.
+template <class Field>
+absl::variant<int, std::string> DecodeRS(const Field& gf, int num_ecc,
+                                         std::vector<unsigned char>* codeword);
+
+// As above, but erasures holds the indexes into codeword of symbols that are
+// suspect. Knowing where they are halves the cost of correcting them: any mix
+// of e erasures and t other errors can be corrected as long as
+// e + 2t <= num_ecc. Erasures that turn out to be right don't count towards
+// the number of symbols corrected.
+template <class Field>
+absl::variant<int, std::string> DecodeRS(const Field& gf, int num_ecc,
+                                         absl::Span<const int> erasures,
+                                         std::vector<unsigned char>* codeword);
+
+namespace rs_internal {
+
+// Evaluates the polynomial whose coefficients are in coeffs, lowest degree
+// first, at x.
+template <class Field>
+unsigned char EvalPoly(const Field& gf,
+                       const std::vector<unsigned char>& coeffs,
+                       unsigned char x) {
+  unsigned char res = 0;
+  for (int i = coeffs.size() - 1; i >= 0; --i) {
+    res = gf.Add({gf.Mult(res, x), coeffs[i]});
+  }
+  return res;
+}
+
+// Returns syndromes S_0 through S_{num-1}: the received polynomial evaluated
+// at each of the generator polynomial's roots. They're all zero if the
+// codeword has no errors.
+template <class Field>
+std::vector<unsigned char> Syndromes(const Field& gf,
+                                     const std::vector<unsigned char>& codeword,
+                                     int num) {
+  std::vector<unsigned char> syndromes(num);
+  for (int i = 0; i < num; ++i) {
+    const unsigned char root = gf.AlphaPow(i);
+    unsigned char s = 0;
+    for (const unsigned char c : codeword) {
+      s = gf.Add({gf.Mult(s, root), c});
+    }
+    syndromes[i] = s;
+  }
+  return syndromes;
+}
+
+// Implements the Berlekamp-Massey algorithm, which finds the shortest linear
+// feedback shift register that generates the syndromes. Its connection
+// polynomial is the error locator polynomial, lambda(x), whose roots are the
+// inverses of the error locations. See
+// https://en.wikipedia.org/wiki/Berlekamp%E2%80%93Massey_algorithm
+//
+// The returned coefficients are lowest degree first, starting with
+// lambda_0 = 1. The number of errors is the degree of the polynomial.
+template <class Field>
+std::vector<unsigned char> BerlekampMassey(
+    const Field& gf, const std::vector<unsigned char>& syndromes) {
+  std::vector<unsigned char> lambda = {1}, prev = {1};
+  int num_errors = 0;
+  int shift = 1;
+  unsigned char prev_discrepancy = 1;
+
+  for (int k = 0; k < syndromes.size(); ++k) {
+    unsigned char discrepancy = syndromes[k];
+    for (int i = 1; i <= num_errors && i < lambda.size(); ++i) {
+      discrepancy =
+          gf.Add({discrepancy, gf.Mult(lambda[i], syndromes[k - i])});
+    }
+
+    if (discrepancy == 0) {
+      ++shift;
+      continue;
+    }
+
+    // lambda(x) -= (discrepancy / prev_discrepancy) * x^shift * prev(x)
+    const unsigned char scale =
+        gf.Mult(discrepancy, gf.Inverse(prev_discrepancy));
+    std::vector<unsigned char> next = lambda;
+    if (next.size() < prev.size() + shift) {
+      next.resize(prev.size() + shift, 0);
+    }
+    for (int i = 0; i < prev.size(); ++i) {
+      next[i + shift] = gf.Sub({next[i + shift], gf.Mult(scale, prev[i])});
+    }
+
+    if (2 * num_errors <= k) {
+      num_errors = k + 1 - num_errors;
+      prev = std::move(lambda);
+      prev_discrepancy = discrepancy;
+      shift = 1;
+    } else {
+      ++shift;
+    }
+    lambda = std::move(next);
+  }
+
+  lambda.resize(num_errors + 1);
+  return lambda;
+}
+
+// Returns the product of two polynomials, with coefficients lowest degree
+// first.
+template <class Field>
+std::vector<unsigned char> MultPoly(const Field& gf,
+                                    const std::vector<unsigned char>& a,
+                                    const std::vector<unsigned char>& b) {
+  std::vector<unsigned char> out(a.size() + b.size() - 1, 0);
+  for (int i = 0; i < a.size(); ++i) {
+    for (int j = 0; j < b.size(); ++j) {
+      out[i + j] = gf.Add({out[i + j], gf.Mult(a[i], b[j])});
+    }
+  }
+  return out;
+}
+
+// FastGF256 versions of the above, which use its bulk operations.
+inline std::vector<unsigned char> Syndromes(
+    const FastGF256& gf, const std::vector<unsigned char>& codeword, int num) {
+  std::vector<unsigned char> roots(num);
+  for (int i = 0; i < num; ++i) {
+    roots[i] = gf.AlphaPow(i);
+  }
+  std::vector<unsigned char> syndromes(num);
+  gf.EvalPoly(codeword, roots, absl::MakeSpan(syndromes));
+  return syndromes;
+}
+
+inline std::vector<unsigned char> MultPoly(
+    const FastGF256& gf, const std::vector<unsigned char>& a,
+    const std::vector<unsigned char>& b) {
+  std::vector<unsigned char> out(a.size() + b.size() - 1, 0);
+  for (int i = 0; i < a.size(); ++i) {
+    gf.MultAdd(a[i], b, absl::MakeSpan(&out[i], b.size()));
+  }
+  return out;
+}
+
+}  // namespace rs_internal
+
+template <class Field>
+absl::variant<int, std::string> DecodeRS(const Field& gf, int num_ecc,
+                                         std::vector<unsigned char>* codeword) {
+  return DecodeRS(gf, num_ecc, {}, codeword);
+}
+
+template <class Field>
+absl::variant<int, std::string> DecodeRS(const Field& gf, int num_ecc,
+                                         absl::Span<const int> erasures,
+                                         std::vector<unsigned char>* codeword) {
+  const int n = codeword->size();
+  const int field_order = (1 << gf.m()) - 1;
+  if (n > field_order) {
+    return absl::StrCat("codeword length ", n, " exceeds field order ",
+                        field_order);
+  }
+  if (num_ecc <= 0 || num_ecc >= n) {
+    return absl::StrCat("bad ECC length ", num_ecc, " for codeword length ",
+                        n);
+  }
+  if (erasures.size() > num_ecc) {
+    return absl::StrCat("too many erasures (", erasures.size(),
+                        ") to correct");
+  }
+
+  const std::vector<unsigned char> syndromes =
+      rs_internal::Syndromes(gf, *codeword, num_ecc);
+  bool all_zero = true;
+  for (const unsigned char s : syndromes) {
+    if (s != 0) {
+      all_zero = false;
+      break;
+    }
+  }
+  if (all_zero) {
+    return 0;
+  }
+
+  // The erasure locator, gamma(x), has a root at alpha^-p for each erased
+  // symbol holding the coefficient of x^p.
+  std::vector<unsigned char> gamma = {1};
+  for (const int index : erasures) {
+    if (index < 0 || index >= n) {
+      return absl::StrCat("erasure ", index, " is outside the codeword");
+    }
+    gamma =
+        rs_internal::MultPoly(gf, gamma, {1, gf.AlphaPow(n - 1 - index)});
+  }
+
+  // The Forney syndromes, S(x) * gamma(x), beyond the first
+  // erasures.size() terms don't depend on the erased symbols, so they let
+  // Berlekamp-Massey find the remaining errors on their own.
+  std::vector<unsigned char> forney_syndromes;
+  for (int k = erasures.size(); k < num_ecc; ++k) {
+    unsigned char t = 0;
+    for (int j = 0; j < gamma.size() && j <= k; ++j) {
+      t = gf.Add({t, gf.Mult(gamma[j], syndromes[k - j])});
+    }
+    forney_syndromes.push_back(t);
+  }
+
+  const std::vector<unsigned char> error_lambda =
+      rs_internal::BerlekampMassey(gf, forney_syndromes);
+  const int num_errors = error_lambda.size() - 1;
+  if (erasures.size() + 2 * num_errors > num_ecc) {
+    return absl::StrCat("too many errors (", num_errors, ") and erasures (",
+                        erasures.size(), ") to correct");
+  }
+
+  // The errata locator covers both.
+  const std::vector<unsigned char> lambda =
+      rs_internal::MultPoly(gf, error_lambda, gamma);
+  const int num_errata = lambda.size() - 1;
+
+  // Chien search: the symbol holding the coefficient of x^p is in error if
+  // alpha^-p is a root of lambda. We only have n symbols, so we only need to
+  // check n powers.
+  std::vector<int> positions;
+  for (int p = 0; p < n; ++p) {
+    if (rs_internal::EvalPoly(gf, lambda, gf.AlphaPow(field_order - p)) == 0) {
+      positions.push_back(p);
+    }
+  }
+  if (positions.size() != num_errata) {
+    // Some of lambda's roots point outside the codeword, so there are more
+    // errors than we can locate.
+    return absl::StrCat("found ", positions.size(), " of ", num_errata,
+                        " error locations");
+  }
+
+  // Forney: the error evaluator polynomial is
+  //
+  //   omega(x) = S(x) * lambda(x) mod x^num_ecc
+  //
+  // and the error at location X, given the generator's first root is
+  // alpha^0, is X * omega(X^-1) / lambda'(X^-1).
+  std::vector<unsigned char> omega =
+      rs_internal::MultPoly(gf, syndromes, lambda);
+  omega.resize(num_ecc);
+
+  // The formal derivative. Even powers vanish in fields of characteristic 2.
+  std::vector<unsigned char> lambda_prime(num_errata, 0);
+  for (int i = 1; i < lambda.size(); i += 2) {
+    lambda_prime[i - 1] = lambda[i];
+  }
+
+  std::vector<unsigned char> corrected = *codeword;
+  int num_corrected = 0;
+  for (const int p : positions) {
+    const unsigned char x = gf.AlphaPow(p);
+    const unsigned char x_inv = gf.AlphaPow(field_order - p);
+    const unsigned char denominator =
+        rs_internal::EvalPoly(gf, lambda_prime, x_inv);
+    if (denominator == 0) {
+      return "error locator has a repeated root";
+    }
+    const unsigned char magnitude =
+        gf.Mult(gf.Mult(x, rs_internal::EvalPoly(gf, omega, x_inv)),
+                gf.Inverse(denominator));
+    if (magnitude == 0) {
+      continue;
+    }
+
+    unsigned char& symbol = corrected[n - 1 - p];
+    symbol = gf.Sub({symbol, magnitude});
+    ++num_corrected;
+  }
+
+  // Errors beyond our capacity can produce a plausible-looking locator, so
+  // make sure we ended up with a codeword.
+  for (const unsigned char s : rs_internal::Syndromes(gf, corrected, num_ecc)) {
+    if (s != 0) {
+      return "failed to correct errors";
+    }
+  }
+
+  *codeword = std::move(corrected);
+  return num_corrected;
+}
+
+#endif  // _QRCODE_RS_H_
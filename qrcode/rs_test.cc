@@ -0,0 +1,185 @@
+#include "qrcode/rs.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAreArray;
+using ::testing::VariantWith;
+
+// The 1-M codeword for "01234567" from the spec's worked example: 16 data
+// codewords followed by 10 ECC codewords.
+const std::vector<unsigned char> kSpecExample = {
+    0b00010000, 0b00100000, 0b00001100, 0b01010110, 0b01100001, 0b10000000,
+    0b11101100, 0b00010001, 0b11101100, 0b00010001, 0b11101100, 0b00010001,
+    0b11101100, 0b00010001, 0b11101100, 0b00010001, 0xa5,       0x24,
+    0xd4,       0xc1,       0xed,       0x36,       0xc7,       0x87,
+    0x2c,       0x55,
+};
+constexpr int kSpecExampleECC = 10;
+
+TEST(DecodeRSTest, NoErrors) {
+  GF256 gf;
+  std::vector<unsigned char> codeword = kSpecExample;
+  EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, &codeword), VariantWith<int>(0));
+  EXPECT_THAT(codeword, ElementsAreArray(kSpecExample));
+}
+
+TEST(DecodeRSTest, Point) {
+  GF256 gf;
+  std::vector<unsigned char> codeword = kSpecExample;
+  codeword[0] ^= 0xff;
+  codeword[25] ^= 0x01;
+
+  EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, &codeword), VariantWith<int>(2));
+  EXPECT_THAT(codeword, ElementsAreArray(kSpecExample));
+}
+
+// Corrupts 1 through 5 symbols, in every data and ECC position.
+TEST(DecodeRSTest, UpToCapacity) {
+  GF256 gf;
+  const int n = kSpecExample.size();
+
+  unsigned int seed = 1;
+  for (int num_errors = 1; num_errors <= kSpecExampleECC / 2; ++num_errors) {
+    for (int start = 0; start < n; ++start) {
+      std::vector<unsigned char> codeword = kSpecExample;
+      for (int i = 0; i < num_errors; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const unsigned char error = 1 + (seed >> 16) % 255;
+        codeword[(start + i * 7) % n] ^= error;
+      }
+
+      EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, &codeword),
+                  VariantWith<int>(num_errors))
+          << num_errors << " errors from " << start;
+      EXPECT_THAT(codeword, ElementsAreArray(kSpecExample))
+          << num_errors << " errors from " << start;
+    }
+  }
+}
+
+// FastGF256 takes different paths through the decoder, so repeat the above
+// with codewords long enough to use its bulk operations.
+TEST(DecodeRSTest, FastField) {
+  GF256 gf;
+  FastGF256 fast;
+
+  // Make a 70-symbol codeword with 20 ECC symbols by erasing the ECC symbols
+  // of arbitrary data and letting the decoder fill them in.
+  constexpr int kECC = 20;
+  std::vector<unsigned char> codeword(70, 0);
+  for (int i = 0; i < 50; ++i) {
+    codeword[i] = kSpecExample[i % kSpecExample.size()] + i;
+  }
+  std::vector<int> erasures;
+  for (int i = 50; i < codeword.size(); ++i) {
+    erasures.push_back(i);
+  }
+  ASSERT_THAT(DecodeRS(fast, kECC, erasures, &codeword), VariantWith<int>(_));
+  const std::vector<unsigned char> want = codeword;
+
+  unsigned int seed = 1;
+  for (int num_errors = 1; num_errors <= kECC / 2; ++num_errors) {
+    std::vector<unsigned char> fast_codeword = want;
+    for (int i = 0; i < num_errors; ++i) {
+      seed = seed * 1103515245 + 12345;
+      fast_codeword[(seed >> 16) % want.size()] ^= 1 + (seed >> 8) % 255;
+    }
+    std::vector<unsigned char> gf_codeword = fast_codeword;
+
+    const auto fast_result = DecodeRS(fast, kECC, &fast_codeword);
+    EXPECT_EQ(fast_result, DecodeRS(gf, kECC, &gf_codeword)) << num_errors;
+    EXPECT_THAT(fast_result, VariantWith<int>(_)) << num_errors;
+    EXPECT_THAT(fast_codeword, ElementsAreArray(want)) << num_errors;
+  }
+}
+
+TEST(DecodeRSTest, TooManyErrors) {
+  GF256 gf;
+  std::vector<unsigned char> codeword = kSpecExample;
+  for (int i = 0; i < 6; ++i) {
+    codeword[i * 4] ^= 0x5a;
+  }
+  const std::vector<unsigned char> corrupted = codeword;
+
+  EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, &codeword),
+              VariantWith<std::string>(_));
+  EXPECT_THAT(codeword, ElementsAreArray(corrupted));
+}
+
+TEST(DecodeRSTest, Erasures) {
+  GF256 gf;
+
+  // Twice as many erasures as errors can be corrected.
+  std::vector<unsigned char> codeword = kSpecExample;
+  std::vector<int> erasures;
+  for (int i = 0; i < kSpecExampleECC; ++i) {
+    codeword[i * 2] ^= 0x81;
+    erasures.push_back(i * 2);
+  }
+  EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, erasures, &codeword),
+              VariantWith<int>(kSpecExampleECC));
+  EXPECT_THAT(codeword, ElementsAreArray(kSpecExample));
+}
+
+TEST(DecodeRSTest, ErasuresAndErrors) {
+  GF256 gf;
+
+  // Four erasures, two of which are actually fine, plus three errors the
+  // decoder has to find for itself.
+  std::vector<unsigned char> codeword = kSpecExample;
+  codeword[1] ^= 0x10;
+  codeword[20] ^= 0x33;
+  codeword[5] ^= 0x01;
+  codeword[9] ^= 0xfe;
+  codeword[25] ^= 0x42;
+  const std::vector<int> erasures = {1, 20, 3, 17};
+
+  EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, erasures, &codeword),
+              VariantWith<int>(5));
+  EXPECT_THAT(codeword, ElementsAreArray(kSpecExample));
+}
+
+TEST(DecodeRSTest, TooManyErasures) {
+  GF256 gf;
+
+  // Eight erasures leave room to correct one error, not two.
+  std::vector<unsigned char> codeword = kSpecExample;
+  std::vector<int> erasures;
+  for (int i = 0; i < 8; ++i) {
+    codeword[i] ^= 0x81;
+    erasures.push_back(i);
+  }
+  codeword[20] ^= 0x01;
+  codeword[22] ^= 0x01;
+  const std::vector<unsigned char> corrupted = codeword;
+
+  EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, erasures, &codeword),
+              VariantWith<std::string>(_));
+  EXPECT_THAT(codeword, ElementsAreArray(corrupted));
+
+  erasures = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  EXPECT_THAT(DecodeRS(gf, kSpecExampleECC, erasures, &codeword),
+              VariantWith<std::string>(_));
+}
+
+TEST(DecodeRSTest, BadArguments) {
+  GF256 gf;
+  std::vector<unsigned char> codeword = kSpecExample;
+  codeword[0] ^= 1;
+  EXPECT_THAT(DecodeRS(gf, 0, &codeword), VariantWith<std::string>(_));
+  EXPECT_THAT(DecodeRS(gf, codeword.size(), &codeword),
+              VariantWith<std::string>(_));
+
+  const std::vector<int> outside = {26};
+  EXPECT_THAT(DecodeRS(gf, 10, outside, &codeword),
+              VariantWith<std::string>(_));
+
+  std::vector<unsigned char> too_long(256, 0);
+  EXPECT_THAT(DecodeRS(gf, 10, &too_long), VariantWith<std::string>(_));
+}
+
+}  // namespace
@@ -0,0 +1,129 @@
+#include "qrcode/run_length_image.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/row_runs.h"
+
+RunLengthImage::RunLengthImage(const unsigned char* data, int width,
+                               int height, int stride, bool with_columns)
+    : width_(width), height_(height) {
+  EncodeRows(data, stride);
+  if (with_columns) {
+    EncodeColumns(data, stride);
+  }
+}
+
+void RunLengthImage::EncodeRows(const unsigned char* data, int stride) {
+  rows_.offsets.reserve(height_ + 1);
+  rows_.first_non_zero.reserve(height_);
+
+  for (int y = 0; y < height_; ++y) {
+    const unsigned char* row = data + y * stride;
+
+    rows_.offsets.push_back(rows_.starts.size());
+    rows_.first_non_zero.push_back(row[0] != 0);
+    rows_.starts.push_back(0);
+
+    for (int x = RowRunLength(row, width_); x < width_;
+         x += RowRunLength(row + x, width_ - x)) {
+      rows_.starts.push_back(x);
+    }
+  }
+  rows_.offsets.push_back(rows_.starts.size());
+}
+
+void RunLengthImage::EncodeColumns(const unsigned char* data, int stride) {
+  // Columns are built in two row-major passes to avoid walking the image
+  // column by column. The first counts the runs in each column so the second
+  // can write each column's starts directly into place.
+  std::vector<int> num_runs(width_, 1);
+  for (int y = 1; y < height_; ++y) {
+    const unsigned char* prev = data + (y - 1) * stride;
+    const unsigned char* row = data + y * stride;
+    for (int x = 0; x < width_; ++x) {
+      if ((row[x] != 0) != (prev[x] != 0)) {
+        ++num_runs[x];
+      }
+    }
+  }
+
+  cols_.offsets.resize(width_ + 1);
+  cols_.offsets[0] = 0;
+  for (int x = 0; x < width_; ++x) {
+    cols_.offsets[x + 1] = cols_.offsets[x] + num_runs[x];
+  }
+  cols_.starts.resize(cols_.offsets[width_]);
+
+  cols_.first_non_zero.resize(width_);
+  std::vector<int> next(cols_.offsets.begin(), cols_.offsets.end() - 1);
+  for (int x = 0; x < width_; ++x) {
+    cols_.first_non_zero[x] = data[x] != 0;
+    cols_.starts[next[x]++] = 0;
+  }
+
+  for (int y = 1; y < height_; ++y) {
+    const unsigned char* prev = data + (y - 1) * stride;
+    const unsigned char* row = data + y * stride;
+    for (int x = 0; x < width_; ++x) {
+      if ((row[x] != 0) != (prev[x] != 0)) {
+        cols_.starts[next[x]++] = y;
+      }
+    }
+  }
+}
+
+bool RunLengthImage::Runs(const Point& p, int delta_x, int delta_y,
+                          absl::Span<int> out) const {
+  const bool vertical = delta_x == 0;
+  assert(!vertical || has_columns());
+
+  const Lines& lines = vertical ? cols_ : rows_;
+  const int line = vertical ? p.x : p.y;
+  const int pos = vertical ? p.y : p.x;
+  const int line_len = vertical ? height_ : width_;
+  const bool forward = (vertical ? delta_y : delta_x) > 0;
+
+  absl::Span<const int> starts = lines.Starts(line);
+  const int n = starts.size();
+
+  // The index of the run containing pos.
+  const int idx =
+      std::upper_bound(starts.begin(), starts.end(), pos) - starts.begin() - 1;
+
+  auto run_end = [&](int i) { return i + 1 < n ? starts[i + 1] : line_len; };
+
+  if (forward) {
+    if (idx + static_cast<int>(out.size()) > n) {
+      return false;
+    }
+    for (int i = 0; i < out.size(); ++i) {
+      const int run = idx + i;
+      const int begin = i == 0 ? pos : starts[run];
+      out[i] = run_end(run) - begin;
+    }
+  } else {
+    if (idx + 1 < static_cast<int>(out.size())) {
+      return false;
+    }
+    for (int i = 0; i < out.size(); ++i) {
+      const int run = idx - i;
+      const int end = i == 0 ? pos + 1 : run_end(run);
+      out[i] = end - starts[run];
+    }
+  }
+
+  return true;
+}
+
+std::unique_ptr<RunLengthImage> RunLengthImageFromGrayImage(
+    const cv::Mat& image, bool with_columns) {
+  // Mats that are views of part of a larger image (ROIs) aren't continuous,
+  // so rows must be found with the stride rather than the width.
+  return absl::make_unique<RunLengthImage>(image.ptr<unsigned char>(0),
+                                           image.cols, image.rows,
+                                           image.step1(), with_columns);
+}
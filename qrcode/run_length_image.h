@@ -0,0 +1,84 @@
+#ifndef _QRCODE_RUN_LENGTH_IMAGE_H_
+#define _QRCODE_RUN_LENGTH_IMAGE_H_ 1
+
+#include <memory>
+#include <vector>
+
+#include "absl/types/span.h"
+
+#include "qrcode/point.h"
+
+namespace cv {
+class Mat;
+}  // namespace cv
+
+// A run-length encoded black-and-white image.
+//
+// Each row (and, optionally, each column) is stored as the positions at which
+// its runs begin. Once built, the runs passing through any point can be found
+// with a binary search rather than by walking pixels, which lets the image be
+// read once and then queried repeatedly.
+//
+// As with Runner, pixels are either 0 or non-zero, and different non-zero
+// values are not distinguished.
+class RunLengthImage {
+ public:
+  // Encodes the width x height image at data, which is not retained. Rows
+  // begin stride bytes apart. Column tables, which are required for vertical
+  // queries, are only built if with_columns is true.
+  RunLengthImage(const unsigned char* data, int width, int height, int stride,
+                 bool with_columns);
+  ~RunLengthImage() = default;
+
+  RunLengthImage(const RunLengthImage&) = delete;
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  bool has_columns() const { return !cols_.offsets.empty(); }
+
+  // Returns the x positions at which the runs in the given row begin. The
+  // first entry is always 0.
+  absl::Span<const int> RowRunStarts(int row) const {
+    return rows_.Starts(row);
+  }
+
+  // Returns true if the given row begins with a non-zero pixel.
+  bool RowStartsNonZero(int row) const { return rows_.first_non_zero[row]; }
+
+  // Fills out with the lengths of the next out.size() runs found by walking
+  // from p in the direction given by delta_x and delta_y, exactly one of which
+  // must be non-zero (and 1 or -1). The first run starts at p, and so may be
+  // shorter than the run that contains p. This is what Runner::Next returns
+  // for a DirectionalIterator positioned at p.
+  //
+  // Returns false, leaving out in an unspecified state, if there aren't that
+  // many runs in that direction. Vertical walks require column tables.
+  bool Runs(const Point& p, int delta_x, int delta_y,
+            absl::Span<int> out) const;
+
+ private:
+  // The runs for a set of lines (either rows or columns), concatenated.
+  struct Lines {
+    absl::Span<const int> Starts(int line) const {
+      return absl::MakeConstSpan(&starts[offsets[line]],
+                                 offsets[line + 1] - offsets[line]);
+    }
+
+    // The runs for line i begin at starts[offsets[i]] and end before
+    // starts[offsets[i+1]].
+    std::vector<int> offsets;
+    std::vector<int> starts;
+    std::vector<bool> first_non_zero;
+  };
+
+  void EncodeRows(const unsigned char* data, int stride);
+  void EncodeColumns(const unsigned char* data, int stride);
+
+  const int width_, height_;
+  Lines rows_, cols_;
+};
+
+std::unique_ptr<RunLengthImage> RunLengthImageFromGrayImage(
+    const cv::Mat& image, bool with_columns);
+
+#endif  // _QRCODE_RUN_LENGTH_IMAGE_H_
@@ -0,0 +1,123 @@
+#include "qrcode/run_length_image.h"
+
+#include <random>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opencv2/opencv.hpp"
+
+#include "qrcode/pixel_iterator.h"
+#include "qrcode/runner.h"
+#include "qrcode/testutils.h"
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+TEST(RunLengthImageTest, Rows) {
+  // Two rows of 10: 1,2,3,4 and 4,3,2,1.
+  std::vector<unsigned char> data = MakeRun({1, 2, 3, 4});
+  std::vector<unsigned char> row2 = MakeRun({0, 4, 3, 2, 1});
+  data.insert(data.end(), row2.begin(), row2.end());
+
+  RunLengthImage image(data.data(), 10, 2, 10, false);
+  EXPECT_FALSE(image.has_columns());
+
+  EXPECT_THAT(image.RowRunStarts(0), ElementsAre(0, 1, 3, 6));
+  EXPECT_TRUE(image.RowStartsNonZero(0));
+  EXPECT_THAT(image.RowRunStarts(1), ElementsAre(0, 4, 7, 9));
+  EXPECT_FALSE(image.RowStartsNonZero(1));
+
+  std::vector<int> out(3);
+  ASSERT_TRUE(image.Runs(Point(2, 0), 1, 0, absl::MakeSpan(out)));
+  EXPECT_THAT(out, ElementsAre(1, 3, 4));
+  ASSERT_TRUE(image.Runs(Point(8, 1), -1, 0, absl::MakeSpan(out)));
+  EXPECT_THAT(out, ElementsAre(2, 3, 4));
+  EXPECT_FALSE(image.Runs(Point(4, 0), 1, 0, absl::MakeSpan(out)));
+  EXPECT_FALSE(image.Runs(Point(5, 1), -1, 0, absl::MakeSpan(out)));
+}
+
+// Every query in every direction must match what a runner reading the pixels
+// returns.
+TEST(RunLengthImageTest, MatchesRunner) {
+  constexpr int kWidth = 23, kHeight = 17;
+
+  std::mt19937 rng(1);
+  std::vector<unsigned char> data(kWidth * kHeight);
+  unsigned char value = 0;
+  for (unsigned char& pixel : data) {
+    // Only change value occasionally so the runs have some length.
+    if (rng() % 4 == 0) {
+      value = 255 - value;
+    }
+    pixel = value;
+  }
+
+  RunLengthImage image(data.data(), kWidth, kHeight, kWidth, true);
+  ASSERT_TRUE(image.has_columns());
+
+  PixelIterator<const unsigned char> iter(data.data(), kWidth, kHeight);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      for (const auto& delta : std::vector<std::pair<int, int>>{
+               {1, 0}, {-1, 0}, {0, 1}, {0, -1}}) {
+        for (int num = 1; num <= 4; ++num) {
+          ASSERT_TRUE(iter.Seek(x, y));
+          FixedRunner<4> runner(
+              DirectionalIterator<const unsigned char>(iter, delta.second,
+                                                       delta.first));
+          auto expected = runner.Next(num, nullptr);
+
+          std::vector<int> out(num);
+          const bool found = image.Runs(Point(x, y), delta.first,
+                                        delta.second, absl::MakeSpan(out));
+
+          ASSERT_EQ(expected.has_value(), found)
+              << Point(x, y) << " " << delta.first << "," << delta.second
+              << " num " << num;
+          if (found) {
+            EXPECT_THAT(out, ElementsAreArray(*expected))
+                << Point(x, y) << " " << delta.first << "," << delta.second;
+          }
+        }
+      }
+    }
+  }
+}
+
+// A region of a larger image isn't continuous: its rows are further apart
+// than its width.
+TEST(RunLengthImageTest, FromRegionOfInterest) {
+  constexpr int kWidth = 31, kHeight = 19;
+
+  std::mt19937 rng(2);
+  cv::Mat full(kHeight, kWidth, CV_8U);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      full.at<unsigned char>(y, x) = rng() % 3 == 0 ? 255 : 0;
+    }
+  }
+
+  const cv::Mat roi = full(cv::Rect(5, 3, 20, 12));
+  ASSERT_FALSE(roi.isContinuous());
+  const cv::Mat copy = roi.clone();
+
+  std::unique_ptr<RunLengthImage> from_roi =
+      RunLengthImageFromGrayImage(roi, true);
+  std::unique_ptr<RunLengthImage> from_copy =
+      RunLengthImageFromGrayImage(copy, true);
+  for (int y = 0; y < roi.rows; ++y) {
+    EXPECT_THAT(from_roi->RowRunStarts(y),
+                ElementsAreArray(from_copy->RowRunStarts(y)))
+        << y;
+  }
+  for (int x = 0; x < roi.cols; ++x) {
+    std::vector<int> want(1), got(1);
+    ASSERT_TRUE(from_copy->Runs(Point(x, 0), 0, 1, absl::MakeSpan(want)));
+    ASSERT_TRUE(from_roi->Runs(Point(x, 0), 0, 1, absl::MakeSpan(got)));
+    EXPECT_EQ(want, got) << x;
+  }
+}
+
+}  // namespace
@@ -1,6 +1,7 @@
 #ifndef _QRCODE_RUNNER_H_
 #define _QRCODE_RUNNER_H_ 1
 
+#include <array>
 #include <map>
 #include <vector>
 
@@ -42,4 +43,90 @@ class Runner {
   std::map<int, int> cache_;
 };
 
+// FixedRunner is a Runner that doesn't allocate. The largest number of runs
+// that can be requested from a single call to Next is fixed at compile time as
+// N, which lets the run cache live in a ring buffer inside the object.
+//
+// When the iterator walks forward along a row, runs are found with the
+// underlying iterator's ForwardRowRunLength rather than one pixel at a time.
+// Iter may be any DirectionalIterator over unsigned char pixels.
+template <int N, class Iter = DirectionalIterator<const unsigned char>>
+class FixedRunner {
+ public:
+  // Does not assume ownership of the data pointed to by the iterator.
+  explicit FixedRunner(Iter iter)
+      : iter_(iter), iter_empty_(false), start_(0), head_(0), size_(0) {}
+  ~FixedRunner() = default;
+
+  FixedRunner(const FixedRunner&) = delete;
+
+  // Behaves like Runner::Next, with two differences: num must be no larger
+  // than N, and the returned span points into this object. The span is
+  // invalidated by the next call to Next.
+  absl::optional<absl::Span<const int>> Next(const int num, int* idx) {
+    if (num <= 0 || num > N) {
+      return absl::nullopt;
+    }
+
+    while (size_ < num) {
+      if (iter_empty_) {
+        return absl::nullopt;
+      }
+
+      // Each run is written twice, N entries apart, so the num runs starting
+      // at head_ are always contiguous.
+      const int len = CountNext();
+      const int pos = (head_ + size_) % N;
+      cache_[pos] = len;
+      cache_[pos + N] = len;
+      ++size_;
+    }
+
+    absl::Span<const int> lens(&cache_[head_], num);
+    if (idx != nullptr) {
+      *idx = start_;
+    }
+
+    start_ += lens[0];
+    head_ = (head_ + 1) % N;
+    --size_;
+
+    return lens;
+  }
+
+ private:
+  int CountNext() {
+    int remaining;
+    const int fast_len = iter_.ForwardRowRunLength(&remaining);
+    if (fast_len > 0) {
+      if (fast_len == remaining) {
+        iter_empty_ = true;
+      } else {
+        iter_.Advance(fast_len);
+      }
+      return fast_len;
+    }
+
+    int len;
+    const unsigned char want = iter_.Get();
+    for (len = 1; iter_.Next(); ++len) {
+      if (iter_.Get() != want) {
+        return len;
+      }
+    }
+
+    iter_empty_ = true;
+    return len;
+  }
+
+  Iter iter_;
+  bool iter_empty_;
+  int start_;
+
+  // The ring buffer. Cached runs begin at head_, which corresponds to start_.
+  std::array<int, 2 * N> cache_;
+  int head_;
+  int size_;
+};
+
 #endif  // _QRCODE_RUNNER_H_
@@ -53,4 +53,62 @@ TEST_F(RunnerTest, Test) {
   ASSERT_THAT(result, Optional(ElementsAre(10)));
 }
 
+TEST_F(RunnerTest, Fixed) {
+  const std::vector<unsigned char> run =
+      MakeRun({1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
+  PixelIterator<const unsigned char> iter(run.data(), run.size(), 1);
+  FixedRunner<8> runner(iter.MakeForwardColumnIterator());
+
+  int idx;
+  absl::optional<absl::Span<const int>> result;
+
+  result = runner.Next(7, &idx);
+  ASSERT_THAT(result, Optional(ElementsAre(1, 2, 3, 4, 5, 6, 7)));
+  EXPECT_EQ(0, idx);
+
+  result = runner.Next(3, &idx);
+  ASSERT_THAT(result, Optional(ElementsAre(2, 3, 4)));
+  EXPECT_EQ(1, idx);
+
+  result = runner.Next(8, &idx);
+  ASSERT_THAT(result, Optional(ElementsAre(3, 4, 5, 6, 7, 8, 9, 10)));
+  EXPECT_EQ(3, idx);
+
+  result = runner.Next(8, &idx);
+  ASSERT_THAT(result, Eq(absl::nullopt));
+
+  // Larger than the window.
+  result = runner.Next(9, &idx);
+  ASSERT_THAT(result, Eq(absl::nullopt));
+
+  // The failed calls didn't consume anything. Walk the ring buffer around a
+  // few times, one run at a time, to the end.
+  for (int i = 4; i <= 10; i++) {
+    result = runner.Next(1, &idx);
+    ASSERT_THAT(result, Optional(ElementsAre(i)));
+    EXPECT_EQ(i * (i - 1) / 2, idx);
+  }
+
+  result = runner.Next(1, nullptr);
+  ASSERT_THAT(result, Eq(absl::nullopt));
+}
+
+TEST_F(RunnerTest, FixedLongRuns) {
+  // Two rows, with runs long enough to span several vector blocks. The
+  // runner must stop at the end of the second row, rather than continuing
+  // into the first.
+  const std::vector<int> lens = {1, 40, 3, 70, 17, 33, 16};
+  std::vector<unsigned char> data = MakeRun(lens);
+  const int width = data.size();
+  data.insert(data.begin(), width, 0);
+
+  PixelIterator<const unsigned char> iter(data.data(), width, 2);
+  iter.Seek(0, 1);
+  FixedRunner<1> runner(iter.MakeForwardColumnIterator());
+  for (int len : lens) {
+    ASSERT_THAT(runner.Next(1, nullptr), Optional(ElementsAre(len)));
+  }
+  EXPECT_THAT(runner.Next(1, nullptr), Eq(absl::nullopt));
+}
+
 }  // namespace
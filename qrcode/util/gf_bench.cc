@@ -0,0 +1,108 @@
+// Compares the speed of GF(256) multiplication through the virtual GF
+// interface with the inlined lookups in FastGF256, and of computing syndromes
+// a point at a time versus with FastGF256::EvalPoly, with and without vector
+// instructions.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+#include "qrcode/gf.h"
+
+ABSL_FLAG(int, iterations, 20000, "number of passes over the buffer");
+ABSL_FLAG(int, syndrome_iterations, 2000, "number of codewords to check");
+
+namespace {
+
+// Multiplies its way through a buffer, the way the Reed-Solomon decoder's
+// polynomial evaluation does, and reports the elapsed time per Mult.
+template <class Field>
+void MeasureMult(const std::string& name, const Field& gf) {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  std::vector<unsigned char> buf(256);
+  for (int i = 0; i < buf.size(); ++i) {
+    buf[i] = i;
+  }
+
+  const absl::Time start = absl::Now();
+  unsigned char res = 0;
+  for (int i = 0; i < iterations; ++i) {
+    for (const unsigned char b : buf) {
+      res = gf.Add({gf.Mult(res, 0x53), b});
+    }
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+
+  std::cout << name << ": "
+            << absl::ToDoubleNanoseconds(elapsed) / (iterations * buf.size())
+            << " ns/mult (" << static_cast<int>(res) << ")\n";
+}
+
+// Computes the syndromes of the largest blocks QR codes use (255 symbols, 30
+// of them ECC), and reports the time per block.
+void MeasureSyndromes() {
+  const int iterations = absl::GetFlag(FLAGS_syndrome_iterations);
+  const FastGF256 gf(false);
+
+  std::vector<unsigned char> codeword(255);
+  unsigned int seed = 1;
+  for (auto& elem : codeword) {
+    seed = seed * 1103515245 + 12345;
+    elem = seed >> 16;
+  }
+  std::vector<unsigned char> roots(30);
+  for (int i = 0; i < roots.size(); ++i) {
+    roots[i] = gf.AlphaPow(i);
+  }
+  std::vector<unsigned char> syndromes(roots.size());
+
+  absl::Time start = absl::Now();
+  for (int n = 0; n < iterations; ++n) {
+    for (int j = 0; j < roots.size(); ++j) {
+      unsigned char res = 0;
+      for (const unsigned char c : codeword) {
+        res = gf.Mult(res, roots[j]) ^ c;
+      }
+      syndromes[j] ^= res;
+    }
+  }
+  const absl::Duration scalar = (absl::Now() - start) / iterations;
+
+  std::cout << "syndromes: point at a time " << absl::FormatDuration(scalar);
+
+  std::vector<unsigned char> out(roots.size());
+  for (const bool use_simd : {false, true}) {
+    const FastGF256 bulk_gf(use_simd);
+    start = absl::Now();
+    for (int n = 0; n < iterations; ++n) {
+      bulk_gf.EvalPoly(codeword, roots, absl::MakeSpan(out));
+      for (int j = 0; j < roots.size(); ++j) {
+        syndromes[j] ^= out[j];
+      }
+    }
+    const absl::Duration bulk = (absl::Now() - start) / iterations;
+
+    std::cout << ", EvalPoly" << (bulk_gf.simd() ? " (AVX2) " : " ")
+              << absl::FormatDuration(bulk);
+  }
+  std::cout << " (" << static_cast<int>(syndromes[0]) << ")\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  GF256 gf256;
+  MeasureMult("GF256", static_cast<const GF&>(gf256));
+  MeasureMult("FastGF256", FastGF256());
+  MeasureSyndromes();
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Compares the speed of the ways of finding runs along image rows. Reports
+// pixels/ns for each over a synthetic image with random run lengths.
+
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+#include "qrcode/pixel_iterator.h"
+#include "qrcode/row_runs.h"
+#include "qrcode/runner.h"
+
+ABSL_FLAG(int, width, 4096, "image width");
+ABSL_FLAG(int, height, 1024, "image height");
+ABSL_FLAG(int, max_run, 64, "maximum run length");
+ABSL_FLAG(int, iterations, 10, "number of passes over the image");
+
+namespace {
+
+std::vector<unsigned char> MakeImage(int width, int height, int max_run) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> len_dist(1, max_run);
+
+  std::vector<unsigned char> data;
+  data.reserve(width * height);
+  for (int y = 0; y < height; ++y) {
+    unsigned char val = y % 2 ? 255 : 0;
+    for (int x = 0; x < width;) {
+      const int len = std::min(len_dist(gen), width - x);
+      data.insert(data.end(), len, val);
+      val = 255 - val;
+      x += len;
+    }
+  }
+  return data;
+}
+
+// Runs fn over every row, returning the total number of runs found so the
+// work can't be optimized away.
+void Measure(const std::string& name, int width, int height,
+             const std::function<int(int)>& fn) {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+
+  int runs = 0;
+  const absl::Time start = absl::Now();
+  for (int i = 0; i < iterations; ++i) {
+    for (int y = 0; y < height; ++y) {
+      runs += fn(y);
+    }
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+
+  const double pixels = static_cast<double>(width) * height * iterations;
+  std::cout << name << ": " << pixels / absl::ToDoubleNanoseconds(elapsed)
+            << " pixels/ns (" << runs << " runs)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const int width = absl::GetFlag(FLAGS_width);
+  const int height = absl::GetFlag(FLAGS_height);
+  const std::vector<unsigned char> data =
+      MakeImage(width, height, absl::GetFlag(FLAGS_max_run));
+  PixelIterator<const unsigned char> iter(data.data(), width, height);
+
+  Measure("Runner", width, height, [&](int y) {
+    iter.Seek(0, y);
+    Runner runner(iter.MakeForwardColumnIterator());
+    int n = 0;
+    for (int x = 0; x < width; x += (*runner.Next(1, nullptr))[0]) {
+      ++n;
+    }
+    return n;
+  });
+
+  Measure("FixedRunner", width, height, [&](int y) {
+    iter.Seek(0, y);
+    FixedRunner<1> runner(iter.MakeForwardColumnIterator());
+    int n = 0;
+    while (runner.Next(1, nullptr).has_value()) {
+      ++n;
+    }
+    return n;
+  });
+
+  auto count_runs = [&](int (*run_length)(const unsigned char*, int), int y) {
+    const unsigned char* row = &data[y * width];
+    int n = 0;
+    for (int x = 0; x < width; x += run_length(row + x, width - x)) {
+      ++n;
+    }
+    return n;
+  };
+
+  Measure("RowRunLengthScalar", width, height,
+          [&](int y) { return count_runs(RowRunLengthScalar, y); });
+  Measure("RowRunLength", width, height,
+          [&](int y) { return count_runs(RowRunLength, y); });
+
+  return 0;
+}